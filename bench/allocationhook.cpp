@@ -0,0 +1,88 @@
+#include "allocationhook.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_watchedAllocations{0};
+std::atomic<uint64_t> g_hotPathAllocations{0};
+std::atomic<bool (*)()> g_hotPathProbe{nullptr};
+thread_local bool t_watched = false;
+
+void countAllocation()
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (!t_watched) {
+        return;
+    }
+
+    g_watchedAllocations.fetch_add(1, std::memory_order_relaxed);
+    bool (*probe)() = g_hotPathProbe.load(std::memory_order_acquire);
+    if (probe && probe()) {
+        g_hotPathAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+} // namespace
+
+uint64_t allocationCount()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t watchedAllocationCount()
+{
+    return g_watchedAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t hotPathAllocationCount()
+{
+    return g_hotPathAllocations.load(std::memory_order_relaxed);
+}
+
+void watchAllocationsOnThisThread()
+{
+    t_watched = true;
+}
+
+void setHotPathProbe(bool (*probe)())
+{
+    g_hotPathProbe.store(probe, std::memory_order_release);
+}
+
+// Kept out of line so GCC does not pair the inlined free() with operator new and warn.
+[[gnu::noinline]] void *operator new(std::size_t size)
+{
+    countAllocation();
+    if (void *pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
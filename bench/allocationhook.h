@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Global operator new replacement for mdb_bench. Every allocation bumps allocationCount();
+// allocations made on a watched thread while the hot-path probe returns true are also
+// counted separately, so the stress mode can fail on them.
+uint64_t allocationCount();
+uint64_t watchedAllocationCount();
+uint64_t hotPathAllocationCount();
+
+void watchAllocationsOnThisThread();
+// The probe runs inside operator new and must itself never allocate.
+void setHotPathProbe(bool (*probe)());
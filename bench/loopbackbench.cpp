@@ -0,0 +1,399 @@
+// End-to-end check of the real I/O path: a uinput mouse and keyboard feed a real
+// InputController, and the MouseDirectionBinder device it creates is read back through
+// evdev. Needs write access to /dev/uinput and read access to the new event nodes, so it
+// is meant for the test machines before a rollout, not for unprivileged CI.
+
+#include "inputcontroller.h"
+#include "latencyhistogram.h"
+#include "motioncalibrator.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr char kMouseName[] = "mdb-loopback-mouse";
+constexpr char kKeyboardName[] = "mdb-loopback-keyboard";
+constexpr char kOutputName[] = "MouseDirectionBinder";
+constexpr int kMotionStep = 8;
+constexpr int kSetupTimeoutMs = 3000;
+constexpr int kFrameTimeoutMs = 500;
+// The release is due kBaseIdleReleaseMs after the last motion; allow for timer slack and
+// a loaded machine, but not for a release that never comes or comes with the motion.
+constexpr int kIdleEarlyMs = MotionCalibrator::kBaseIdleReleaseMs / 2;
+constexpr int kIdleLateMs = MotionCalibrator::kBaseIdleReleaseMs + 100;
+constexpr unsigned long kPollIntervalMs = 5;
+
+struct Options {
+    unsigned iterations{200};
+    unsigned intervalMs{5};
+    bool libinput{false};
+    uint64_t maxP99Us{0};
+};
+
+void printUsage(const char *program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [--iterations N] [--interval MS] [--backend evdev|libinput] [--max-p99 US]\n"
+                 "Injects alternating REL_X motion through a uinput mouse while a uinput keyboard holds\n"
+                 "Left Shift, and reads the controller's %s device back through evdev.\n"
+                 "Exit status: 0 passed, 1 failed, 2 uinput or evdev not accessible.\n",
+                 program, kOutputName);
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (argument == "--iterations" && hasValue) {
+            options.iterations = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--interval" && hasValue) {
+            options.intervalMs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--backend" && hasValue) {
+            const std::string backend = argv[++i];
+            if (backend != "evdev" && backend != "libinput") {
+                return false;
+            }
+            options.libinput = (backend == "libinput");
+        } else if (argument == "--max-p99" && hasValue) {
+            options.maxP99Us = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.iterations > 0;
+}
+
+uint64_t monotonicNs()
+{
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
+
+uint64_t eventTimeNs(const input_event &event)
+{
+    return static_cast<uint64_t>(event.input_event_sec) * 1000000000ULL + static_cast<uint64_t>(event.input_event_usec) * 1000ULL;
+}
+
+// A uinput device created by this process, removed again on destruction.
+class VirtualDevice
+{
+public:
+    ~VirtualDevice()
+    {
+        if (m_fd >= 0) {
+            ioctl(m_fd, UI_DEV_DESTROY);
+            ::close(m_fd);
+        }
+    }
+
+    bool create(const char *name, bool pointer, QString &errorText)
+    {
+        m_fd = ::open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (m_fd < 0) {
+            errorText = QStringLiteral("/dev/uinput: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+            return false;
+        }
+
+        bool configured = ioctl(m_fd, UI_SET_EVBIT, EV_KEY) >= 0;
+        if (pointer) {
+            // libinput only takes a relative device for a mouse if it also has a button.
+            configured = configured && ioctl(m_fd, UI_SET_KEYBIT, BTN_LEFT) >= 0 && ioctl(m_fd, UI_SET_EVBIT, EV_REL) >= 0 &&
+                         ioctl(m_fd, UI_SET_RELBIT, REL_X) >= 0 && ioctl(m_fd, UI_SET_RELBIT, REL_Y) >= 0;
+        } else {
+            configured = configured && ioctl(m_fd, UI_SET_KEYBIT, KEY_LEFTSHIFT) >= 0 && ioctl(m_fd, UI_SET_KEYBIT, KEY_A) >= 0;
+        }
+
+        uinput_setup setup{};
+        setup.id.bustype = BUS_VIRTUAL;
+        setup.id.vendor = 0x1338;
+        setup.id.product = pointer ? 0x0001 : 0x0002;
+        std::strncpy(setup.name, name, sizeof(setup.name) - 1);
+        configured = configured && ioctl(m_fd, UI_DEV_SETUP, &setup) >= 0 && ioctl(m_fd, UI_DEV_CREATE) >= 0;
+        if (!configured) {
+            errorText = QStringLiteral("%1: %2").arg(QString::fromLatin1(name), QString::fromLocal8Bit(strerror(errno)));
+            return false;
+        }
+
+        char sysname[64] = {};
+        if (ioctl(m_fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+            errorText = QStringLiteral("UI_GET_SYSNAME: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+            return false;
+        }
+        const QStringList events = QDir(QStringLiteral("/sys/class/input/%1").arg(QString::fromLatin1(sysname)))
+                                       .entryList({QStringLiteral("event*")}, QDir::Dirs);
+        if (events.isEmpty()) {
+            errorText = QStringLiteral("%1: no event node").arg(QString::fromLatin1(name));
+            return false;
+        }
+        m_node = QStringLiteral("/dev/input/%1").arg(events.first());
+        return true;
+    }
+
+    QString node() const { return m_node; }
+
+    bool send(uint16_t type, uint16_t code, int32_t value)
+    {
+        input_event events[2] = {};
+        events[0].type = type;
+        events[0].code = code;
+        events[0].value = value;
+        events[1].type = EV_SYN;
+        events[1].code = SYN_REPORT;
+        return ::write(m_fd, events, sizeof(events)) == static_cast<ssize_t>(sizeof(events));
+    }
+
+private:
+    int m_fd{-1};
+    QString m_node;
+};
+
+QSet<QString> outputNodes()
+{
+    QSet<QString> nodes;
+    const QStringList events = QDir(QStringLiteral("/sys/class/input")).entryList({QStringLiteral("event*")}, QDir::Dirs);
+    for (const QString &event : events) {
+        QFile name(QStringLiteral("/sys/class/input/%1/device/name").arg(event));
+        if (name.open(QIODevice::ReadOnly) && name.readAll().trimmed() == kOutputName) {
+            nodes.insert(QStringLiteral("/dev/input/%1").arg(event));
+        }
+    }
+    return nodes;
+}
+
+// Reads one SYN_REPORT-terminated frame that contains at least one key event.
+bool readKeyFrame(int fd, int timeoutMs, std::vector<input_event> &frame)
+{
+    frame.clear();
+    const uint64_t deadline = monotonicNs() + static_cast<uint64_t>(timeoutMs) * 1000000ULL;
+    for (;;) {
+        input_event event{};
+        const ssize_t length = ::read(fd, &event, sizeof(event));
+        if (length == static_cast<ssize_t>(sizeof(event))) {
+            if (event.type == EV_KEY) {
+                frame.push_back(event);
+            } else if (event.type == EV_SYN && event.code == SYN_REPORT && !frame.empty()) {
+                frame.push_back(event);
+                return true;
+            }
+            continue;
+        }
+        if (length < 0 && errno != EAGAIN && errno != EINTR) {
+            return false;
+        }
+
+        const uint64_t now = monotonicNs();
+        if (now >= deadline) {
+            return false;
+        }
+        pollfd ready{fd, POLLIN, 0};
+        poll(&ready, 1, static_cast<int>((deadline - now) / 1000000ULL) + 1);
+    }
+}
+
+bool frameMatches(const std::vector<input_event> &frame, uint16_t released, uint16_t pressed)
+{
+    bool sawRelease = (released == 0);
+    bool sawPress = (pressed == 0);
+    for (const input_event &event : frame) {
+        if (event.type != EV_KEY) {
+            continue;
+        }
+        if (event.code == released && event.value == 0) {
+            sawRelease = true;
+        } else if (event.code == pressed && event.value == 1) {
+            sawPress = true;
+        } else {
+            return false;
+        }
+    }
+    return sawRelease && sawPress;
+}
+
+template<typename Predicate>
+bool waitFor(Predicate predicate, int timeoutMs)
+{
+    for (int waitedMs = 0; waitedMs < timeoutMs; waitedMs += static_cast<int>(kPollIntervalMs)) {
+        if (predicate()) {
+            return true;
+        }
+        QThread::msleep(kPollIntervalMs);
+    }
+    return predicate();
+}
+
+void printLatency(const char *label, const LatencyHistogram &histogram)
+{
+    const LatencyHistogram::Summary summary = histogram.summary();
+    std::printf("%s %.1f / %.1f / %.1f us\n", label, summary.p50 / 1000.0, summary.p99 / 1000.0, summary.max / 1000.0);
+}
+
+int runLoopback(const Options &options)
+{
+    QString errorText;
+    VirtualDevice mouse;
+    VirtualDevice keyboard;
+    if (!mouse.create(kMouseName, true, errorText) || !keyboard.create(kKeyboardName, false, errorText)) {
+        std::fprintf(stderr, "loopback: %s\n", errorText.toLocal8Bit().constData());
+        return 2;
+    }
+
+    const QSet<QString> existingOutputs = outputNodes();
+
+    InputController controller;
+    controller.setInputBackend(options.libinput ? InputBackend::Kind::Libinput : InputBackend::Kind::Evdev,
+                               options.libinput ? QStringList() : QStringList{mouse.node(), keyboard.node()});
+    controller.setPointerBrandFilters({QString::fromLatin1(kMouseName)}, QStringList());
+    controller.setKeyboardBrandFilters({QString::fromLatin1(kKeyboardName)}, QStringList());
+
+    std::atomic<bool> failed{false};
+    std::atomic<bool> devicesReady{false};
+    QObject::connect(&controller, &InputController::errorOccurred, &controller, [&failed](const QString &message) {
+        std::fprintf(stderr, "controller: %s\n", message.toLocal8Bit().constData());
+        failed.store(true, std::memory_order_relaxed);
+    }, Qt::DirectConnection);
+    QObject::connect(&controller, &InputController::inventoryChanged, &controller, [&devicesReady](const DeviceInventory &inventory) {
+        bool pointer = false;
+        bool keyboard = false;
+        for (const DeviceInventoryEntry &entry : inventory) {
+            pointer = pointer || (entry.pointerAllowed && entry.descriptor.contains(QString::fromLatin1(kMouseName)));
+            keyboard = keyboard || (entry.keyboardAllowed && entry.descriptor.contains(QString::fromLatin1(kKeyboardName)));
+        }
+        devicesReady.store(pointer && keyboard, std::memory_order_release);
+    }, Qt::DirectConnection);
+
+    controller.start();
+    const auto stop = [&controller] {
+        controller.stopController();
+        controller.wait();
+    };
+
+    QString outputNode;
+    // Another instance may already be running; ours is the node that was not there before.
+    waitFor([&] {
+        for (const QString &node : outputNodes()) {
+            if (!existingOutputs.contains(node)) {
+                outputNode = node;
+            }
+        }
+        return !outputNode.isEmpty();
+    }, kSetupTimeoutMs);
+    const int output = outputNode.isEmpty() ? -1 : ::open(QFile::encodeName(outputNode).constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (output < 0) {
+        std::fprintf(stderr, "loopback: %s device not found or not readable\n", kOutputName);
+        stop();
+        return 2;
+    }
+    int clockId = CLOCK_MONOTONIC;
+    ioctl(output, EVIOCSCLOCKID, &clockId);
+
+    if (!waitFor([&] { return devicesReady.load(std::memory_order_acquire); }, kSetupTimeoutMs)) {
+        std::fprintf(stderr, "loopback: controller did not pick up the virtual devices\n");
+        ::close(output);
+        stop();
+        return 1;
+    }
+
+    keyboard.send(EV_KEY, KEY_LEFTSHIFT, 1);
+    if (!waitFor([&] { return controller.statusSnapshot().activationHeld; }, kSetupTimeoutMs)) {
+        std::fprintf(stderr, "loopback: activation key was not registered\n");
+        ::close(output);
+        stop();
+        return 1;
+    }
+
+    LatencyHistogram toKernel;
+    LatencyHistogram toReader;
+    unsigned missing = 0;
+    unsigned wrong = 0;
+    uint16_t held = 0;
+    std::vector<input_event> frame;
+    for (unsigned i = 0; i < options.iterations; ++i) {
+        const bool right = (i % 2 == 0);
+        const uint16_t expected = right ? KEY_D : KEY_A;
+
+        const uint64_t injectedNs = monotonicNs();
+        mouse.send(EV_REL, REL_X, right ? kMotionStep : -kMotionStep);
+        if (!readKeyFrame(output, kFrameTimeoutMs, frame)) {
+            ++missing;
+            continue;
+        }
+        const uint64_t observedNs = monotonicNs();
+
+        if (!frameMatches(frame, held, expected)) {
+            ++wrong;
+        }
+        held = expected;
+        const uint64_t kernelNs = eventTimeNs(frame.front());
+        if (kernelNs >= injectedNs) {
+            toKernel.record(kernelNs - injectedNs);
+        }
+        toReader.record(observedNs - injectedNs);
+
+        if (options.intervalMs > 0) {
+            QThread::msleep(options.intervalMs);
+        }
+    }
+
+    // No more motion: the held key has to come back up on its own.
+    const uint64_t idleStartNs = monotonicNs();
+    const bool released = held != 0 && readKeyFrame(output, kIdleLateMs * 4, frame) && frameMatches(frame, held, 0);
+    const double idleMs = static_cast<double>(monotonicNs() - idleStartNs) / 1e6;
+    const bool idleOk = released && idleMs >= kIdleEarlyMs && idleMs <= kIdleLateMs;
+
+    keyboard.send(EV_KEY, KEY_LEFTSHIFT, 0);
+    ::close(output);
+    stop();
+
+    const LatencyHistogram::Summary summary = toReader.summary();
+    std::printf("loopback (%s):\n", options.libinput ? "libinput" : "evdev");
+    std::printf("  transitions:         %llu of %u (%u missing, %u wrong)\n", static_cast<unsigned long long>(summary.count),
+                options.iterations, missing, wrong);
+    printLatency("  inject -> uinput    p50/p99/max:", toKernel);
+    printLatency("  inject -> reader    p50/p99/max:", toReader);
+    std::printf("  idle release:        %s after %.1f ms (expected %u ms)\n", released ? "yes" : "no", idleMs,
+                MotionCalibrator::kBaseIdleReleaseMs);
+
+    bool passed = !failed.load(std::memory_order_relaxed) && missing == 0 && wrong == 0 && idleOk;
+    if (options.maxP99Us > 0 && summary.p99 > options.maxP99Us * 1000) {
+        std::fprintf(stderr, "loopback: p99 %.1f us exceeds --max-p99 %llu us\n", summary.p99 / 1000.0,
+                     static_cast<unsigned long long>(options.maxP99Us));
+        passed = false;
+    }
+    return passed ? 0 : 1;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    QCoreApplication application(argc, argv);
+    return runLoopback(options);
+}
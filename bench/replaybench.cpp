@@ -0,0 +1,350 @@
+#include "allocationhook.h"
+#include "directionengine.h"
+#include "stressbench.h"
+#include "tracerecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+constexpr uint32_t kStressRatesHz[] = {1000, 4000, 8000};
+
+struct ReplayEvent {
+    enum class Type : uint8_t {
+        Motion,
+        Key
+    };
+
+    Type type{Type::Motion};
+    uint64_t timeUsec{0};
+    double dx{0.0};
+    double dxUnaccelerated{0.0};
+    uint32_t key{0};
+    bool pressed{false};
+};
+
+class CountingSink
+{
+public:
+    void applyTransition(uint16_t releasedKeycode, uint16_t pressedKeycode)
+    {
+        if (releasedKeycode != 0) {
+            ++m_releases;
+        }
+        if (pressedKeycode != 0) {
+            ++m_presses;
+        }
+        ++m_frames;
+    }
+
+    uint64_t frames() const { return m_frames; }
+    uint64_t presses() const { return m_presses; }
+    uint64_t releases() const { return m_releases; }
+
+private:
+    uint64_t m_frames{0};
+    uint64_t m_presses{0};
+    uint64_t m_releases{0};
+};
+
+struct Options {
+    std::string tracePath;
+    std::size_t syntheticEvents{2000000};
+    unsigned iterations{5};
+    uint32_t seed{1};
+    bool randomizer{false};
+    int randomizerMinimum{70};
+    int randomizerMaximum{90};
+    // Stands in for a device calibration; the controller writes it into the engine per event.
+    double threshold{FixedThreshold::kThreshold};
+    std::vector<uint32_t> stressRatesHz;
+    uint32_t stressDurationMs{3000};
+};
+
+void printUsage(const char *program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [--trace FILE] [--events N] [--iterations N] [--seed N] [--randomizer MIN-MAX]\n"
+                 "          [--threshold DX]\n"
+                 "       %s --stress RATE|all [--duration MS]\n"
+                 "\n"
+                 "FILE is either a binary trace written by Trace/Path or a text file with lines\n"
+                 "\"m <usec> <dx> <dxRaw>\" or \"k <usec> <keycode> <0|1>\"; '#' starts a comment.\n"
+                 "\n"
+                 "--stress runs the real controller loop on synthetic motion at RATE Hz (all: 1000,\n"
+                 "4000 and 8000) with frames written to /dev/null, and exits with 1 if the controller\n"
+                 "thread allocates while the activation key is held.\n",
+                 program, program);
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (argument == "--trace" && hasValue) {
+            options.tracePath = argv[++i];
+        } else if (argument == "--events" && hasValue) {
+            options.syntheticEvents = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argument == "--iterations" && hasValue) {
+            options.iterations = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--seed" && hasValue) {
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (argument == "--randomizer" && hasValue) {
+            options.randomizer = true;
+            if (std::sscanf(argv[++i], "%d-%d", &options.randomizerMinimum, &options.randomizerMaximum) != 2) {
+                return false;
+            }
+        } else if (argument == "--threshold" && hasValue) {
+            options.threshold = std::strtod(argv[++i], nullptr);
+            if (!(options.threshold > 0.0)) {
+                return false;
+            }
+        } else if (argument == "--stress" && hasValue) {
+            const std::string rate = argv[++i];
+            if (rate == "all") {
+                options.stressRatesHz.assign(std::begin(kStressRatesHz), std::end(kStressRatesHz));
+            } else {
+                const unsigned long rateHz = std::strtoul(rate.c_str(), nullptr, 10);
+                if (rateHz == 0 || rateHz > 1000000) {
+                    return false;
+                }
+                options.stressRatesHz.assign(1, static_cast<uint32_t>(rateHz));
+            }
+        } else if (argument == "--duration" && hasValue) {
+            options.stressDurationMs = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+    return options.iterations > 0 && options.stressDurationMs > 0;
+}
+
+bool loadBinaryTrace(std::ifstream &input, const std::string &path, std::vector<ReplayEvent> &events)
+{
+    TraceFileHeader header{};
+    if (!input.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        header.version != TraceRecorder::kVersion || header.recordSize != sizeof(TraceRecord) ||
+        header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0) {
+        std::fprintf(stderr, "%s: unsupported trace header\n", path.c_str());
+        return false;
+    }
+
+    std::vector<TraceRecord> records(header.capacity);
+    if (!input.read(reinterpret_cast<char *>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TraceRecord)))) {
+        std::fprintf(stderr, "%s: truncated trace\n", path.c_str());
+        return false;
+    }
+
+    const uint64_t count = std::min(header.writeIndex, header.capacity);
+    const uint64_t first = header.writeIndex - count;
+    events.reserve(count);
+    for (uint64_t i = first; i < header.writeIndex; ++i) {
+        const TraceRecord &record = records[i & (header.capacity - 1)];
+        ReplayEvent event;
+        event.timeUsec = record.timeUsec;
+        if (record.type == TraceEventType::PointerMotion || record.type == TraceEventType::PointerMotionAbsolute) {
+            event.type = ReplayEvent::Type::Motion;
+            event.dx = record.dx;
+            event.dxUnaccelerated = record.dxUnaccelerated;
+        } else if (record.type == TraceEventType::KeyboardKey) {
+            event.type = ReplayEvent::Type::Key;
+            event.key = record.key;
+            event.pressed = record.pressed != 0;
+        } else {
+            continue;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+bool loadTrace(const std::string &path, std::vector<ReplayEvent> &events)
+{
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        std::fprintf(stderr, "Cannot open trace %s: %s\n", path.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    char magic[sizeof(TraceRecorder::kMagic)] = {};
+    if (input.read(magic, sizeof(magic)) && std::memcmp(magic, TraceRecorder::kMagic, sizeof(magic)) == 0) {
+        input.seekg(0);
+        return loadBinaryTrace(input, path, events);
+    }
+    input.clear();
+    input.seekg(0);
+
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        char tag = 0;
+        ReplayEvent event;
+        fields >> tag >> event.timeUsec;
+        if (tag == 'm') {
+            event.type = ReplayEvent::Type::Motion;
+            fields >> event.dx >> event.dxUnaccelerated;
+        } else if (tag == 'k') {
+            int pressed = 0;
+            event.type = ReplayEvent::Type::Key;
+            fields >> event.key >> pressed;
+            event.pressed = pressed != 0;
+        } else {
+            fields.setstate(std::ios::failbit);
+        }
+
+        if (!fields) {
+            std::fprintf(stderr, "%s:%zu: malformed trace line\n", path.c_str(), lineNumber);
+            return false;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+// Roughly what a 1 kHz mouse produces during play: the activation key is held in bursts
+// while the pointer sweeps left and right, with jitter around the motion threshold.
+void generateSynthetic(std::size_t count, uint32_t seed, std::vector<ReplayEvent> &events)
+{
+    std::mt19937 engine(seed);
+    std::normal_distribution<double> jitter(0.0, 0.6);
+    std::uniform_int_distribution<int> burstLength(200, 2000);
+    std::uniform_int_distribution<int> sweepLength(20, 120);
+
+    events.reserve(count);
+    uint64_t timeUsec = 0;
+    bool activationHeld = false;
+    int untilToggle = 0;
+    int untilSweep = 0;
+    double sweep = 1.0;
+
+    while (events.size() < count) {
+        timeUsec += 1000;
+
+        if (untilToggle-- <= 0) {
+            activationHeld = !activationHeld;
+            untilToggle = burstLength(engine);
+
+            ReplayEvent key;
+            key.type = ReplayEvent::Type::Key;
+            key.timeUsec = timeUsec;
+            key.key = KEY_LEFTSHIFT;
+            key.pressed = activationHeld;
+            events.push_back(key);
+            continue;
+        }
+
+        if (untilSweep-- <= 0) {
+            sweep = -sweep;
+            untilSweep = sweepLength(engine);
+        }
+
+        ReplayEvent motion;
+        motion.type = ReplayEvent::Type::Motion;
+        motion.timeUsec = timeUsec;
+        motion.dxUnaccelerated = sweep + jitter(engine);
+        motion.dx = motion.dxUnaccelerated * 1.4;
+        events.push_back(motion);
+    }
+}
+
+template<typename Engine>
+void replay(Engine &engine, const std::vector<ReplayEvent> &events, double threshold)
+{
+    for (const ReplayEvent &event : events) {
+        if (event.type == ReplayEvent::Type::Key) {
+            engine.handleKey(event.key, event.pressed);
+        } else {
+            // As InputController does from the pointer's PointerState before every motion.
+            engine.threshold().value = threshold;
+            engine.handleMotion(event.dx, event.dxUnaccelerated);
+        }
+    }
+    engine.resetActivation();
+}
+
+template<typename Engine>
+void runBenchmark(Engine &engine, const std::vector<ReplayEvent> &events, const Options &options)
+{
+    replay(engine, events, options.threshold);
+    const uint64_t framesBefore = engine.sink().frames();
+    const uint64_t pressesBefore = engine.sink().presses();
+
+    using Clock = std::chrono::steady_clock;
+    const uint64_t allocationsBefore = allocationCount();
+    const Clock::time_point start = Clock::now();
+    for (unsigned i = 0; i < options.iterations; ++i) {
+        replay(engine, events, options.threshold);
+    }
+    const Clock::time_point end = Clock::now();
+    const uint64_t allocations = allocationCount() - allocationsBefore;
+
+    const double totalEvents = static_cast<double>(events.size()) * options.iterations;
+    const double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+    std::printf("source:            %s\n", options.tracePath.empty() ? "synthetic" : options.tracePath.c_str());
+    std::printf("engine:            %s\n", options.randomizer ? "randomized" : "plain");
+    std::printf("threshold:         %.3f\n", options.threshold);
+    std::printf("events:            %zu x %u\n", events.size(), options.iterations);
+    std::printf("events/sec:        %.0f\n", totalEvents / (elapsedNs / 1e9));
+    std::printf("ns/event:          %.2f\n", elapsedNs / totalEvents);
+    std::printf("allocations/event: %.4f\n", static_cast<double>(allocations) / totalEvents);
+    std::printf("transitions:       %llu frames, %llu presses\n",
+                static_cast<unsigned long long>(engine.sink().frames() - framesBefore),
+                static_cast<unsigned long long>(engine.sink().presses() - pressesBefore));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    if (!options.stressRatesHz.empty()) {
+        return runStress(argc, argv, options.stressRatesHz, options.stressDurationMs);
+    }
+
+    std::vector<ReplayEvent> events;
+    if (!options.tracePath.empty()) {
+        if (!loadTrace(options.tracePath, events)) {
+            return 1;
+        }
+    } else {
+        generateSynthetic(options.syntheticEvents, options.seed, events);
+    }
+
+    if (events.empty()) {
+        std::fprintf(stderr, "No events to replay\n");
+        return 1;
+    }
+
+    if (options.randomizer) {
+        // Same policies as InputController's RandomizedEngine and PlainEngine, only the sink differs.
+        DirectionEngine<DeviceThreshold, PercentRandomizer, CountingSink> engine(
+            CountingSink{}, DeviceThreshold{options.threshold}, PercentRandomizer(options.seed, options.randomizerMinimum, options.randomizerMaximum));
+        runBenchmark(engine, events, options);
+    } else {
+        DirectionEngine<DeviceThreshold, NoRandomizer, CountingSink> engine(CountingSink{}, DeviceThreshold{options.threshold});
+        runBenchmark(engine, events, options);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "stressbench.h"
+
+#include "allocationhook.h"
+#include "inputcontroller.h"
+#include "syntheticbackend.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QThread>
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+constexpr uint32_t kShutdownMarginMs = 2000;
+constexpr unsigned long kPollIntervalMs = 10;
+
+std::atomic<InputController *> g_controller{nullptr};
+
+bool activationHeld()
+{
+    const InputController *controller = g_controller.load(std::memory_order_acquire);
+    return controller && controller->statusSnapshot().activationHeld;
+}
+
+bool runRate(uint32_t rateHz, uint32_t durationMs)
+{
+    SyntheticStats stats;
+    InputController controller;
+    controller.setVirtualDeviceEnabled(false);
+    controller.setBackendFactory([&stats, rateHz, durationMs](InputBackendHost &host) {
+        return std::make_unique<SyntheticBackend>(host, rateHz, durationMs, stats);
+    });
+    const QStringList synthetic{QStringLiteral("synthetic")};
+    controller.setPointerBrandFilters(synthetic, QStringList());
+    controller.setKeyboardBrandFilters(synthetic, QStringList());
+    QObject::connect(&controller, &QThread::started, &controller, [] { watchAllocationsOnThisThread(); }, Qt::DirectConnection);
+
+    std::atomic<bool> failed{false};
+    QObject::connect(&controller, &InputController::errorOccurred, &controller, [&failed](const QString &errorText) {
+        std::fprintf(stderr, "controller: %s\n", errorText.toLocal8Bit().constData());
+        failed.store(true, std::memory_order_relaxed);
+    }, Qt::DirectConnection);
+
+    const uint64_t watchedBefore = watchedAllocationCount();
+    const uint64_t hotPathBefore = hotPathAllocationCount();
+
+    g_controller.store(&controller, std::memory_order_release);
+    controller.start();
+    for (uint32_t waitedMs = 0; !stats.finished.load(std::memory_order_acquire) && !controller.isFinished() &&
+                                waitedMs < durationMs + kShutdownMarginMs;
+         waitedMs += kPollIntervalMs) {
+        QThread::msleep(kPollIntervalMs);
+    }
+    controller.stopController();
+    controller.wait();
+    g_controller.store(nullptr, std::memory_order_release);
+
+    const uint64_t hotPathAllocations = hotPathAllocationCount() - hotPathBefore;
+    const LatencyHistogram::Summary latency = controller.latencyHistogram().summary();
+    const double achievedHz = static_cast<double>(stats.motionEvents) * 1000.0 / durationMs;
+
+    std::printf("stress %u Hz:\n", rateHz);
+    std::printf("  motion events:       %llu (%.0f/sec, %llu missed ticks)\n",
+                static_cast<unsigned long long>(stats.motionEvents), achievedHz,
+                static_cast<unsigned long long>(stats.missedTicks));
+    std::printf("  transitions:         %llu\n", static_cast<unsigned long long>(latency.count));
+    std::printf("  latency p50/p99/max: %.1f / %.1f / %.1f us\n", latency.p50 / 1000.0, latency.p99 / 1000.0,
+                latency.max / 1000.0);
+    std::printf("  thread allocations:  %llu total, %llu while held\n",
+                static_cast<unsigned long long>(watchedAllocationCount() - watchedBefore),
+                static_cast<unsigned long long>(hotPathAllocations));
+
+    if (!stats.finished.load(std::memory_order_acquire)) {
+        std::fprintf(stderr, "stress %u Hz: synthetic run did not complete\n", rateHz);
+        failed.store(true, std::memory_order_relaxed);
+    }
+    if (hotPathAllocations != 0) {
+        std::fprintf(stderr, "stress %u Hz: hot path allocated %llu times while the activation key was held\n", rateHz,
+                     static_cast<unsigned long long>(hotPathAllocations));
+        failed.store(true, std::memory_order_relaxed);
+    }
+    return !failed.load(std::memory_order_relaxed);
+}
+} // namespace
+
+int runStress(int argc, char **argv, const std::vector<uint32_t> &ratesHz, uint32_t durationMs)
+{
+    QCoreApplication application(argc, argv);
+    setHotPathProbe(&activationHeld);
+
+    bool passed = true;
+    for (uint32_t rateHz : ratesHz) {
+        passed = runRate(rateHz, durationMs) && passed;
+    }
+    setHotPathProbe(nullptr);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Drives SyntheticBackend through a real InputController run loop at each rate and fails
+// if the controller thread allocates while the activation key is held.
+int runStress(int argc, char **argv, const std::vector<uint32_t> &ratesHz, uint32_t durationMs);
@@ -0,0 +1,140 @@
+#include "syntheticbackend.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr uint32_t kSweepMs = 40;
+
+uint64_t monotonicUsec()
+{
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000ULL + static_cast<uint64_t>(now.tv_nsec) / 1000ULL;
+}
+} // namespace
+
+SyntheticBackend::SyntheticBackend(InputBackendHost &host, uint32_t rateHz, uint32_t durationMs, SyntheticStats &stats)
+    : InputBackend(host)
+    , m_rateHz(rateHz ? rateHz : 1000)
+    , m_totalTicks(static_cast<uint64_t>(m_rateHz) * durationMs / 1000)
+    , m_sweepTicks(static_cast<uint64_t>(m_rateHz) * kSweepMs / 1000)
+    , m_stats(stats)
+{
+    m_pointer.name = QString::fromLatin1(kDeviceName);
+    m_pointer.sysname = QStringLiteral("synthetic-pointer");
+    m_pointer.pointer = true;
+    m_keyboard.name = QString::fromLatin1(kDeviceName);
+    m_keyboard.sysname = QStringLiteral("synthetic-keyboard");
+    m_keyboard.keyboard = true;
+}
+
+SyntheticBackend::~SyntheticBackend()
+{
+    close();
+}
+
+bool SyntheticBackend::open(QString &errorText)
+{
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timerFd < 0) {
+        errorText = QStringLiteral("timerfd_create(): %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    // tv_nsec must stay below one second, so a period of 1 s or more (1 Hz) goes to tv_sec.
+    const uint64_t periodNs = 1000000000ULL / m_rateHz;
+    itimerspec spec{};
+    spec.it_interval.tv_sec = static_cast<time_t>(periodNs / 1000000000ULL);
+    spec.it_interval.tv_nsec = static_cast<long>(periodNs % 1000000000ULL);
+    spec.it_value = spec.it_interval;
+    if (timerfd_settime(m_timerFd, 0, &spec, nullptr) < 0) {
+        errorText = QStringLiteral("timerfd_settime(): %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SyntheticBackend::close()
+{
+    if (m_timerFd >= 0) {
+        ::close(m_timerFd);
+        m_timerFd = -1;
+    }
+}
+
+bool SyntheticBackend::dispatch(QString &errorText)
+{
+    uint64_t expirations = 0;
+    if (read(m_timerFd, &expirations, sizeof(expirations)) < 0) {
+        if (errno == EAGAIN || errno == EINTR) {
+            return true;
+        }
+        errorText = QStringLiteral("timerfd read(): %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    if (m_finished) {
+        return true;
+    }
+
+    const uint64_t now = monotonicUsec();
+    if (!m_started) {
+        m_started = true;
+        emitEvent(InputEvent::Type::DeviceAdded, &m_pointer, now);
+        emitEvent(InputEvent::Type::DeviceAdded, &m_keyboard, now);
+        emitKey(true, now);
+    }
+
+    // A real mouse does not replay reports the host was too slow to read; neither do we.
+    m_stats.missedTicks += expirations - 1;
+    m_tick += expirations;
+    emitMotion(now);
+
+    if (m_tick >= m_totalTicks) {
+        emitKey(false, monotonicUsec());
+        m_finished = true;
+        itimerspec stop{};
+        timerfd_settime(m_timerFd, 0, &stop, nullptr);
+        m_stats.finished.store(true, std::memory_order_release);
+    }
+    return true;
+}
+
+void SyntheticBackend::emitEvent(InputEvent::Type type, InputDevice *device, uint64_t timeUsec)
+{
+    m_event = InputEvent{};
+    m_event.type = type;
+    m_event.device = device;
+    m_event.timeUsec = timeUsec;
+    m_host.handleInputEvent(m_event);
+}
+
+void SyntheticBackend::emitKey(bool pressed, uint64_t timeUsec)
+{
+    m_event = InputEvent{};
+    m_event.type = InputEvent::Type::KeyboardKey;
+    m_event.device = &m_keyboard;
+    m_event.timeUsec = timeUsec;
+    m_event.key = kActivationKeycode;
+    m_event.pressed = pressed;
+    m_host.handleInputEvent(m_event);
+}
+
+void SyntheticBackend::emitMotion(uint64_t timeUsec)
+{
+    const bool left = m_sweepTicks != 0 && (m_tick / m_sweepTicks) % 2 == 1;
+    m_event = InputEvent{};
+    m_event.type = InputEvent::Type::PointerMotion;
+    m_event.device = &m_pointer;
+    m_event.timeUsec = timeUsec;
+    m_event.dx = left ? -1.0 : 1.0;
+    m_event.dxUnaccelerated = m_event.dx;
+    m_host.handleInputEvent(m_event);
+    ++m_stats.motionEvents;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "inputbackend.h"
+
+#include <atomic>
+#include <cstdint>
+
+#include <linux/input-event-codes.h>
+
+// Owned by the caller so it outlives the backend, which the controller destroys on exit.
+struct SyntheticStats {
+    uint64_t motionEvents{0};
+    uint64_t missedTicks{0};
+    std::atomic<bool> finished{false};
+};
+
+// Generates one pointer report per timerfd tick at a fixed rate: the activation key is
+// pressed after the first tick, the pointer sweeps left and right for the configured
+// duration, then the key is released and the backend goes quiet.
+class SyntheticBackend : public InputBackend
+{
+public:
+    static constexpr char kDeviceName[] = "Synthetic Stress Device";
+    static constexpr uint16_t kActivationKeycode = KEY_LEFTSHIFT;
+
+    SyntheticBackend(InputBackendHost &host, uint32_t rateHz, uint32_t durationMs, SyntheticStats &stats);
+    ~SyntheticBackend() override;
+
+    Kind kind() const override { return Kind::Synthetic; }
+    bool open(QString &errorText) override;
+    void close() override;
+    int fd() const override { return m_timerFd; }
+    bool dispatch(QString &errorText) override;
+
+private:
+    void emitEvent(InputEvent::Type type, InputDevice *device, uint64_t timeUsec);
+    void emitKey(bool pressed, uint64_t timeUsec);
+    void emitMotion(uint64_t timeUsec);
+
+    uint32_t m_rateHz;
+    uint64_t m_totalTicks;
+    uint64_t m_sweepTicks;
+    int m_timerFd{-1};
+    SyntheticStats &m_stats;
+
+    InputDevice m_pointer;
+    InputDevice m_keyboard;
+    InputEvent m_event;
+
+    uint64_t m_tick{0};
+    bool m_started{false};
+    bool m_finished{false};
+};
@@ -0,0 +1,423 @@
+#include "appsettings.h"
+
+#include "inputcontroller.h"
+#include "tracerecorder.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QVariant>
+
+#include <QtGlobal>
+
+#include <algorithm>
+
+namespace
+{
+QString preparedPath(const QString &path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    return path;
+}
+} // namespace
+
+SettingsStore::SettingsStore(const QString &path)
+    : m_settings(preparedPath(path), QSettings::IniFormat)
+{
+    m_settings.setFallbacksEnabled(false);
+    // Always write through a temporary file and rename, never in place.
+    m_settings.setAtomicSyncRequired(true);
+}
+
+QString SettingsStore::defaultConfigPath()
+{
+    const QString home = QDir::homePath();
+    QDir configDir(home + QStringLiteral("/.config"));
+    return configDir.filePath(QStringLiteral("Mouse→A_D Helper.ini"));
+}
+
+AppSettings SettingsStore::load()
+{
+    m_settings.sync();
+
+    AppSettings settings;
+    settings.activationKey = m_settings.value(QStringLiteral("Input/ActivationKey"), static_cast<quint32>(KEY_LEFTSHIFT)).toUInt();
+    settings.inputBackend = m_settings.value(QStringLiteral("Input/Backend"), QStringLiteral("libinput")).toString().trimmed().toLower();
+    settings.evdevDevices = parseBrandString(m_settings.value(QStringLiteral("Input/EvdevDevices")).toString());
+    settings.coalesceMotion = m_settings.value(QStringLiteral("Input/CoalesceMotion"), false).toBool();
+    settings.coalesceHysteresis = std::max(0.0, m_settings.value(QStringLiteral("Input/CoalesceHysteresis"), 1.0).toDouble());
+    settings.tracePath = m_settings.value(QStringLiteral("Trace/Path")).toString().trimmed();
+    settings.traceCapacity = m_settings.value(QStringLiteral("Trace/Capacity"), static_cast<quint64>(TraceRecorder::kDefaultCapacity)).toULongLong();
+    settings.realtime.policy = realtimePolicyFromString(m_settings.value(QStringLiteral("Realtime/Policy"), QStringLiteral("none")).toString());
+    settings.realtime.priority = std::clamp(m_settings.value(QStringLiteral("Realtime/Priority"), 10).toInt(), 1, 99);
+    settings.realtime.lockMemory = m_settings.value(QStringLiteral("Realtime/LockMemory"), false).toBool();
+    settings.realtime.timerSlackUs = m_settings.value(QStringLiteral("Realtime/TimerSlackUs"), 0).toUInt();
+    for (const QString &entry : parseBrandString(m_settings.value(QStringLiteral("Realtime/CpuAffinity")).toString())) {
+        bool ok = false;
+        const int cpu = entry.toInt(&ok);
+        if (ok && cpu >= 0) {
+            settings.realtime.cpus.append(cpu);
+        }
+    }
+    settings.randomizerEnabled = m_settings.value(QStringLiteral("Randomizer/Enabled"), false).toBool();
+    settings.randomizerMinimum = std::clamp(m_settings.value(QStringLiteral("Randomizer/Minimum"), 70).toInt(), 0, 100);
+    settings.randomizerMaximum = std::clamp(m_settings.value(QStringLiteral("Randomizer/Maximum"), 90).toInt(), 0, 100);
+    if (settings.randomizerMaximum < settings.randomizerMinimum) {
+        std::swap(settings.randomizerMaximum, settings.randomizerMinimum);
+    }
+    settings.theme = m_settings.value(QStringLiteral("Appearance/Theme"), QStringLiteral("Dark")).toString();
+
+    settings.calibrations = readCalibrations();
+    settings.mappingProfile = m_settings.value(QStringLiteral("Mapping/Profile"), QStringLiteral("ad")).toString().trimmed();
+    settings.mappingProfiles = readMappingProfiles();
+    settings.cachedPointer = readCachedDevice(QStringLiteral("DeviceCache/Pointer/"));
+    settings.cachedKeyboard = readCachedDevice(QStringLiteral("DeviceCache/Keyboard/"));
+
+    settings.pointerAllowedBrands = readBrandList(QStringLiteral("Devices/PointerAllow"), defaultPointerBrands());
+    settings.pointerBlockedBrands = readBrandList(QStringLiteral("Devices/PointerBlock"), defaultBlockedBrands());
+    settings.keyboardAllowedBrands = readBrandList(QStringLiteral("Devices/KeyboardAllow"), defaultKeyboardBrands());
+    settings.keyboardBlockedBrands = readBrandList(QStringLiteral("Devices/KeyboardBlock"), defaultBlockedBrands());
+
+    const auto ensureBinder = [](QStringList &list) {
+        for (const QString &entry : list) {
+            if (entry.compare(QStringLiteral("MouseDirectionBinder"), Qt::CaseInsensitive) == 0) {
+                return;
+            }
+        }
+        list.append(QStringLiteral("MouseDirectionBinder"));
+    };
+    ensureBinder(settings.pointerBlockedBrands);
+    ensureBinder(settings.keyboardBlockedBrands);
+
+    if (settings.mappingProfiles.isEmpty()) {
+        MappingProfile profile;
+        profile.name = QStringLiteral("ad");
+        settings.mappingProfiles.append(profile);
+    }
+
+    return settings;
+}
+
+bool SettingsStore::save(const AppSettings &settings)
+{
+    m_settings.setValue(QStringLiteral("Input/ActivationKey"), settings.activationKey);
+    m_settings.setValue(QStringLiteral("Input/Backend"), settings.inputBackend);
+    m_settings.setValue(QStringLiteral("Input/EvdevDevices"), brandsToString(settings.evdevDevices));
+    m_settings.setValue(QStringLiteral("Input/CoalesceMotion"), settings.coalesceMotion);
+    m_settings.setValue(QStringLiteral("Input/CoalesceHysteresis"), settings.coalesceHysteresis);
+    m_settings.setValue(QStringLiteral("Trace/Path"), settings.tracePath);
+    m_settings.setValue(QStringLiteral("Trace/Capacity"), settings.traceCapacity);
+    m_settings.setValue(QStringLiteral("Realtime/Policy"), realtimePolicyToString(settings.realtime.policy));
+    m_settings.setValue(QStringLiteral("Realtime/Priority"), settings.realtime.priority);
+    m_settings.setValue(QStringLiteral("Realtime/LockMemory"), settings.realtime.lockMemory);
+    m_settings.setValue(QStringLiteral("Realtime/TimerSlackUs"), settings.realtime.timerSlackUs);
+    QStringList cpus;
+    for (int cpu : settings.realtime.cpus) {
+        cpus.append(QString::number(cpu));
+    }
+    m_settings.setValue(QStringLiteral("Realtime/CpuAffinity"), cpus.join(QStringLiteral(", ")));
+    m_settings.setValue(QStringLiteral("Randomizer/Enabled"), settings.randomizerEnabled);
+    m_settings.setValue(QStringLiteral("Randomizer/Minimum"), settings.randomizerMinimum);
+    m_settings.setValue(QStringLiteral("Randomizer/Maximum"), settings.randomizerMaximum);
+    m_settings.setValue(QStringLiteral("Appearance/Theme"), settings.theme);
+    writeBrandList(QStringLiteral("Devices/PointerAllow"), settings.pointerAllowedBrands);
+    writeBrandList(QStringLiteral("Devices/PointerBlock"), settings.pointerBlockedBrands);
+    writeBrandList(QStringLiteral("Devices/KeyboardAllow"), settings.keyboardAllowedBrands);
+    writeBrandList(QStringLiteral("Devices/KeyboardBlock"), settings.keyboardBlockedBrands);
+    writeCalibrations(settings.calibrations);
+    m_settings.setValue(QStringLiteral("Mapping/Profile"), settings.mappingProfile);
+    writeMappingProfiles(settings.mappingProfiles);
+    writeCachedDevice(QStringLiteral("DeviceCache/Pointer/"), settings.cachedPointer);
+    writeCachedDevice(QStringLiteral("DeviceCache/Keyboard/"), settings.cachedKeyboard);
+    m_settings.sync();
+    return m_settings.status() == QSettings::NoError;
+}
+
+QStringList SettingsStore::readBrandList(const QString &key, const QStringList &fallback) const
+{
+    const QString raw = m_settings.value(key).toString();
+    if (raw.trimmed().isEmpty()) {
+        return fallback;
+    }
+
+    QStringList parsed = parseBrandString(raw);
+    if (parsed.isEmpty()) {
+        return fallback;
+    }
+    return parsed;
+}
+
+void SettingsStore::writeBrandList(const QString &key, const QStringList &values)
+{
+    m_settings.setValue(key, brandsToString(values));
+}
+
+QVector<DeviceCalibration> SettingsStore::readCalibrations()
+{
+    QVector<DeviceCalibration> calibrations;
+    m_settings.beginGroup(QStringLiteral("Calibration"));
+    const QStringList groups = m_settings.childGroups();
+    for (const QString &group : groups) {
+        const QStringList ids = group.split(QLatin1Char('_'));
+        bool vendorOk = false;
+        bool productOk = false;
+        DeviceCalibration calibration;
+        if (ids.size() == 2) {
+            calibration.vendor = ids.at(0).toUInt(&vendorOk, 16);
+            calibration.product = ids.at(1).toUInt(&productOk, 16);
+        }
+        if (!vendorOk || !productOk) {
+            continue;
+        }
+
+        calibration.name = m_settings.value(group + QStringLiteral("/Name")).toString();
+        calibration.result.reportRateHz = m_settings.value(group + QStringLiteral("/ReportRateHz")).toDouble();
+        calibration.result.motionThreshold = std::clamp(m_settings.value(group + QStringLiteral("/Threshold"), MotionCalibrator::kBaseThreshold).toDouble(),
+                                                        MotionCalibrator::kMinimumThreshold, MotionCalibrator::kBaseThreshold);
+        calibration.result.idleReleaseMs = std::clamp(m_settings.value(group + QStringLiteral("/IdleReleaseMs"), MotionCalibrator::kBaseIdleReleaseMs).toUInt(),
+                                                      MotionCalibrator::kMinimumIdleReleaseMs, MotionCalibrator::kBaseIdleReleaseMs);
+        calibrations.append(calibration);
+    }
+    m_settings.endGroup();
+    return calibrations;
+}
+
+void SettingsStore::writeCalibrations(const QVector<DeviceCalibration> &calibrations)
+{
+    for (const DeviceCalibration &calibration : calibrations) {
+        const QString group = QStringLiteral("Calibration/%1_%2/")
+                                  .arg(calibration.vendor, 4, 16, QLatin1Char('0'))
+                                  .arg(calibration.product, 4, 16, QLatin1Char('0'));
+        m_settings.setValue(group + QStringLiteral("Name"), calibration.name);
+        m_settings.setValue(group + QStringLiteral("ReportRateHz"), qRound(calibration.result.reportRateHz));
+        m_settings.setValue(group + QStringLiteral("Threshold"), calibration.result.motionThreshold);
+        m_settings.setValue(group + QStringLiteral("IdleReleaseMs"), calibration.result.idleReleaseMs);
+    }
+}
+
+QVector<MappingProfile> SettingsStore::readMappingProfiles()
+{
+    QVector<MappingProfile> profiles;
+    m_settings.beginGroup(QStringLiteral("Mapping/Profiles"));
+    const QStringList groups = m_settings.childGroups();
+    for (const QString &group : groups) {
+        const auto keycode = [this, &group](const QString &key) -> quint16 {
+            const uint value = m_settings.value(group + QLatin1Char('/') + key, 0).toUInt();
+            return value <= KEY_MAX ? static_cast<quint16>(value) : 0;
+        };
+        MappingProfile profile;
+        profile.name = group;
+        profile.left = keycode(QStringLiteral("Left"));
+        profile.right = keycode(QStringLiteral("Right"));
+        profile.up = keycode(QStringLiteral("Up"));
+        profile.down = keycode(QStringLiteral("Down"));
+        profile.upLeft = keycode(QStringLiteral("UpLeft"));
+        profile.upRight = keycode(QStringLiteral("UpRight"));
+        profile.downLeft = keycode(QStringLiteral("DownLeft"));
+        profile.downRight = keycode(QStringLiteral("DownRight"));
+        profiles.append(profile);
+    }
+    m_settings.endGroup();
+    return profiles;
+}
+
+void SettingsStore::writeMappingProfiles(const QVector<MappingProfile> &profiles)
+{
+    for (const MappingProfile &profile : profiles) {
+        const QString group = QStringLiteral("Mapping/Profiles/%1/").arg(profile.name);
+        m_settings.setValue(group + QStringLiteral("Left"), profile.left);
+        m_settings.setValue(group + QStringLiteral("Right"), profile.right);
+        m_settings.setValue(group + QStringLiteral("Up"), profile.up);
+        m_settings.setValue(group + QStringLiteral("Down"), profile.down);
+        m_settings.setValue(group + QStringLiteral("UpLeft"), profile.upLeft);
+        m_settings.setValue(group + QStringLiteral("UpRight"), profile.upRight);
+        m_settings.setValue(group + QStringLiteral("DownLeft"), profile.downLeft);
+        m_settings.setValue(group + QStringLiteral("DownRight"), profile.downRight);
+    }
+}
+
+CachedDevice SettingsStore::readCachedDevice(const QString &group) const
+{
+    CachedDevice device;
+    device.node = m_settings.value(group + QStringLiteral("Node")).toString().trimmed();
+    device.name = m_settings.value(group + QStringLiteral("Name")).toString();
+    device.vendor = m_settings.value(group + QStringLiteral("Vendor")).toString().toUInt(nullptr, 16);
+    device.product = m_settings.value(group + QStringLiteral("Product")).toString().toUInt(nullptr, 16);
+    return device;
+}
+
+void SettingsStore::writeCachedDevice(const QString &group, const CachedDevice &device)
+{
+    if (device.node.isEmpty()) {
+        return;
+    }
+    m_settings.setValue(group + QStringLiteral("Node"), device.node);
+    m_settings.setValue(group + QStringLiteral("Name"), device.name);
+    m_settings.setValue(group + QStringLiteral("Vendor"), QStringLiteral("%1").arg(device.vendor, 4, 16, QLatin1Char('0')));
+    m_settings.setValue(group + QStringLiteral("Product"), QStringLiteral("%1").arg(device.product, 4, 16, QLatin1Char('0')));
+}
+
+QStringList parseBrandString(const QString &value)
+{
+    QString normalised = value;
+    normalised.replace(QLatin1Char(';'), QLatin1Char(','));
+    QStringList parts = normalised.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    QStringList result;
+    result.reserve(parts.size());
+    for (QString part : parts) {
+        part = part.trimmed();
+        if (!part.isEmpty() && !result.contains(part, Qt::CaseInsensitive)) {
+            result.append(part);
+        }
+    }
+    return result;
+}
+
+QString brandsToString(const QStringList &values)
+{
+    QStringList cleaned;
+    cleaned.reserve(values.size());
+    for (QString value : values) {
+        value = value.trimmed();
+        if (!value.isEmpty() && !cleaned.contains(value, Qt::CaseInsensitive)) {
+            cleaned.append(value);
+        }
+    }
+    return cleaned.join(QStringLiteral(", "));
+}
+
+QStringList defaultPointerBrands()
+{
+    return {
+        QStringLiteral("Logitech"), QStringLiteral("SteelSeries"), QStringLiteral("Razer"),
+        QStringLiteral("ASUS"), QStringLiteral("Synaptics"), QStringLiteral("ELAN"),
+        QStringLiteral("Apple"), QStringLiteral("Microsoft"), QStringLiteral("Lenovo"),
+        QStringLiteral("HP"), QStringLiteral("Dell"), QStringLiteral("Glorious"),
+        QStringLiteral("Zowie"), QStringLiteral("Touchpad"), QStringLiteral("Mouse")
+    };
+}
+
+QStringList defaultKeyboardBrands()
+{
+    return {
+        QStringLiteral("Logitech"), QStringLiteral("SteelSeries"), QStringLiteral("Razer"),
+        QStringLiteral("ASUS"), QStringLiteral("Corsair"), QStringLiteral("MSI"),
+        QStringLiteral("Keychron"), QStringLiteral("Anne"), QStringLiteral("Ducky"),
+        QStringLiteral("Vortex"), QStringLiteral("Apple"), QStringLiteral("Lenovo"),
+        QStringLiteral("Dell"), QStringLiteral("Keyboard")
+    };
+}
+
+QStringList defaultBlockedBrands()
+{
+    return {
+        QStringLiteral("Virtual"), QStringLiteral("uinput"), QStringLiteral("seat"),
+        QStringLiteral("test"), QStringLiteral("dummy"), QStringLiteral("MouseDirectionBinder")
+    };
+}
+
+void mergeCalibrations(QVector<DeviceCalibration> &stored, const QVector<DeviceCalibration> &calibrations)
+{
+    for (const DeviceCalibration &calibration : calibrations) {
+        bool replaced = false;
+        for (DeviceCalibration &entry : stored) {
+            if (entry.vendor == calibration.vendor && entry.product == calibration.product) {
+                entry = calibration;
+                replaced = true;
+                break;
+            }
+        }
+        if (!replaced) {
+            stored.append(calibration);
+        }
+    }
+}
+
+bool updateDeviceCache(AppSettings &settings, const CachedDevice &pointer, const CachedDevice &keyboard)
+{
+    const auto update = [](CachedDevice &stored, const CachedDevice &device) {
+        if (device.node.isEmpty() ||
+            (stored.node == device.node && stored.name == device.name && stored.vendor == device.vendor && stored.product == device.product)) {
+            return false;
+        }
+        stored = device;
+        return true;
+    };
+    const bool pointerChanged = update(settings.cachedPointer, pointer);
+    const bool keyboardChanged = update(settings.cachedKeyboard, keyboard);
+    return pointerChanged || keyboardChanged;
+}
+
+KeyMap activeKeyMap(const AppSettings &settings)
+{
+    if (settings.mappingProfiles.isEmpty()) {
+        return KeyMap{};
+    }
+
+    const MappingProfile *profile = &settings.mappingProfiles.first();
+    for (const MappingProfile &candidate : settings.mappingProfiles) {
+        if (candidate.name.compare(settings.mappingProfile, Qt::CaseInsensitive) == 0) {
+            profile = &candidate;
+            break;
+        }
+    }
+    return KeyMap::fromDirections(profile->left, profile->right, profile->up, profile->down, profile->upLeft, profile->upRight,
+                                  profile->downLeft, profile->downRight);
+}
+
+QVector<uint16_t> mappedKeys(const AppSettings &settings)
+{
+    QVector<uint16_t> keys;
+    for (const MappingProfile &profile : settings.mappingProfiles) {
+        for (const quint16 keycode : {profile.left, profile.right, profile.up, profile.down, profile.upLeft, profile.upRight,
+                                      profile.downLeft, profile.downRight}) {
+            if (keycode != 0 && !keys.contains(keycode)) {
+                keys.append(keycode);
+            }
+        }
+    }
+    if (keys.isEmpty()) {
+        keys = {KEY_A, KEY_D};
+    }
+    return keys;
+}
+
+void configureController(InputController &controller, const AppSettings &settings)
+{
+    const bool useEvdev = (settings.inputBackend.compare(QStringLiteral("evdev"), Qt::CaseInsensitive) == 0);
+    controller.setInputBackend(useEvdev ? InputBackend::Kind::Evdev : InputBackend::Kind::Libinput, settings.evdevDevices);
+    controller.setMotionCoalescing(settings.coalesceMotion, settings.coalesceHysteresis);
+    controller.setTraceRecording(settings.tracePath, settings.traceCapacity);
+    controller.setDeviceCalibrations(settings.calibrations);
+    controller.setMappedKeys(mappedKeys(settings));
+    controller.setCachedDevices({settings.cachedPointer, settings.cachedKeyboard});
+    controller.setRealtimeOptions(settings.realtime);
+    applyLiveSettings(controller, settings);
+}
+
+void applyLiveSettings(InputController &controller, const AppSettings &settings)
+{
+    LiveConfig config;
+    config.activationKeycode = settings.activationKey;
+    config.randomizerEnabled = settings.randomizerEnabled;
+    if (settings.randomizerEnabled) {
+        config.randomizerMinimum = settings.randomizerMinimum;
+        config.randomizerMaximum = settings.randomizerMaximum;
+    }
+    config.pointerAllowedBrands = settings.pointerAllowedBrands;
+    config.pointerBlockedBrands = settings.pointerBlockedBrands;
+    config.keyboardAllowedBrands = settings.keyboardAllowedBrands;
+    config.keyboardBlockedBrands = settings.keyboardBlockedBrands;
+    config.calibrations = settings.calibrations;
+    config.keyMap = activeKeyMap(settings);
+    controller.applyLiveConfig(config);
+}
+
+void applyRandomizerSettings(InputController &controller, const AppSettings &settings)
+{
+    controller.setRandomizerEnabled(settings.randomizerEnabled);
+    if (settings.randomizerEnabled) {
+        controller.setRandomizerRange(settings.randomizerMinimum, settings.randomizerMaximum);
+    } else {
+        controller.setRandomizerRange(100, 100);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "directionengine.h"
+#include "inputbackend.h"
+#include "motioncalibrator.h"
+#include "realtimetuning.h"
+
+#include <QSettings>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <linux/input-event-codes.h>
+
+class InputController;
+
+// Target keys per direction; 0 leaves that direction unmapped (diagonals fall back to the
+// horizontal key, see KeyMap::fromDirections()). The default reproduces the classic A/D binding.
+struct MappingProfile {
+    QString name;
+    quint16 left{KEY_A};
+    quint16 right{KEY_D};
+    quint16 up{0};
+    quint16 down{0};
+    quint16 upLeft{0};
+    quint16 upRight{0};
+    quint16 downLeft{0};
+    quint16 downRight{0};
+};
+
+// Everything persisted in the INI file; shared by the GUI and mdb-daemon.
+struct AppSettings {
+    quint32 activationKey{KEY_LEFTSHIFT};
+    QString inputBackend;
+    QStringList evdevDevices;
+    bool coalesceMotion{false};
+    double coalesceHysteresis{1.0};
+    QString tracePath;
+    quint64 traceCapacity{0};
+    RealtimeOptions realtime;
+    bool randomizerEnabled{false};
+    int randomizerMinimum{70};
+    int randomizerMaximum{90};
+    QString theme;
+    QVector<DeviceCalibration> calibrations;
+    CachedDevice cachedPointer;
+    CachedDevice cachedKeyboard;
+    QStringList pointerAllowedBrands;
+    QStringList pointerBlockedBrands;
+    QStringList keyboardAllowedBrands;
+    QStringList keyboardBlockedBrands;
+    QString mappingProfile{QStringLiteral("ad")};
+    QVector<MappingProfile> mappingProfiles;
+};
+
+class SettingsStore
+{
+public:
+    explicit SettingsStore(const QString &path = defaultConfigPath());
+
+    static QString defaultConfigPath();
+
+    // Rereads the file if it changed on disk; never writes. Missing keys come back as their
+    // defaults, and the next save() puts them in the file so they can be edited.
+    AppSettings load();
+    // Returns false when QSettings could not write the file.
+    bool save(const AppSettings &settings);
+    QString fileName() const { return m_settings.fileName(); }
+
+private:
+    QStringList readBrandList(const QString &key, const QStringList &fallback) const;
+    void writeBrandList(const QString &key, const QStringList &values);
+    QVector<DeviceCalibration> readCalibrations();
+    void writeCalibrations(const QVector<DeviceCalibration> &calibrations);
+    QVector<MappingProfile> readMappingProfiles();
+    void writeMappingProfiles(const QVector<MappingProfile> &profiles);
+    CachedDevice readCachedDevice(const QString &group) const;
+    void writeCachedDevice(const QString &group, const CachedDevice &device);
+
+    QSettings m_settings;
+};
+
+QStringList parseBrandString(const QString &value);
+QString brandsToString(const QStringList &values);
+QStringList defaultPointerBrands();
+QStringList defaultKeyboardBrands();
+QStringList defaultBlockedBrands();
+// Replaces entries with the same VID/PID and appends the rest.
+void mergeCalibrations(QVector<DeviceCalibration> &stored, const QVector<DeviceCalibration> &calibrations);
+
+// The table for settings.mappingProfile; an unknown name falls back to the first profile.
+KeyMap activeKeyMap(const AppSettings &settings);
+// Union of the keys of every profile, for the one-time uinput setup.
+QVector<uint16_t> mappedKeys(const AppSettings &settings);
+
+// Empty entries keep what is cached for that role; returns whether anything changed.
+bool updateDeviceCache(AppSettings &settings, const CachedDevice &pointer, const CachedDevice &keyboard);
+
+// Everything InputController needs before start(), including the initial activation key
+// and randomizer state.
+void configureController(InputController &controller, const AppSettings &settings);
+// Sends everything that can change at runtime as one snapshot; used for INI hot-reload.
+void applyLiveSettings(InputController &controller, const AppSettings &settings);
+// A disabled randomizer is also sent a 100-100 range so the engine always syncs.
+void applyRandomizerSettings(InputController &controller, const AppSettings &settings);
@@ -0,0 +1,149 @@
+#include "brandmatcher.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace
+{
+quint64 deviceKey(quint32 vendor, quint32 product)
+{
+    return (static_cast<quint64>(vendor) << 32) | product;
+}
+} // namespace
+
+BrandMatcher::BrandMatcher()
+{
+    compile({});
+}
+
+BrandMatcher::BrandMatcher(const QStringList &allowed, const QStringList &blocked)
+{
+    std::vector<Pattern> patterns;
+    patterns.reserve(static_cast<std::size_t>(allowed.size() + blocked.size()));
+
+    const auto collect = [&](const QStringList &entries, uint8_t match, QSet<quint64> &ids) {
+        for (const QString &entry : entries) {
+            quint32 vendor = 0;
+            quint32 product = 0;
+            if (parseDeviceId(entry, vendor, product)) {
+                ids.insert(deviceKey(vendor, product));
+                continue;
+            }
+            const QByteArray text = entry.trimmed().toLower().toUtf8();
+            if (!text.isEmpty()) {
+                patterns.push_back({text, match});
+            }
+        }
+    };
+    collect(allowed, kAllowedMatch, m_allowedIds);
+    collect(blocked, kBlockedMatch, m_blockedIds);
+
+    m_hasAllowRules = !m_allowedIds.isEmpty() ||
+                      std::any_of(patterns.begin(), patterns.end(), [](const Pattern &pattern) { return pattern.match == kAllowedMatch; });
+    compile(patterns);
+}
+
+bool BrandMatcher::allows(const QString &name, quint32 vendor, quint32 product) const
+{
+    const quint64 key = deviceKey(vendor, product);
+    if (m_blockedIds.contains(key)) {
+        return false;
+    }
+
+    const uint8_t matches = scan(name.toLower().toUtf8());
+    if (matches & kBlockedMatch) {
+        return false;
+    }
+    if (!m_hasAllowRules) {
+        return true;
+    }
+    return m_allowedIds.contains(key) || (matches & kAllowedMatch);
+}
+
+bool BrandMatcher::parseDeviceId(const QString &entry, quint32 &vendor, quint32 &product)
+{
+    const QStringList parts = entry.trimmed().split(QLatin1Char(':'));
+    if (parts.size() != 2 || parts.at(0).isEmpty() || parts.at(0).size() > 4 || parts.at(1).isEmpty() || parts.at(1).size() > 4) {
+        return false;
+    }
+
+    bool vendorOk = false;
+    bool productOk = false;
+    vendor = parts.at(0).toUInt(&vendorOk, 16);
+    product = parts.at(1).toUInt(&productOk, 16);
+    return vendorOk && productOk;
+}
+
+void BrandMatcher::compile(const std::vector<Pattern> &patterns)
+{
+    m_columnForByte.fill(0);
+    m_columns = 1;
+    for (const Pattern &pattern : patterns) {
+        for (char byte : pattern.text) {
+            uint16_t &column = m_columnForByte[static_cast<uint8_t>(byte)];
+            if (column == 0) {
+                column = static_cast<uint16_t>(m_columns++);
+            }
+        }
+    }
+
+    // Trie first, with -1 for missing edges; the breadth-first pass below fills every missing
+    // edge from the failure link so scanning never has to backtrack.
+    m_transitions.assign(static_cast<std::size_t>(m_columns), -1);
+    m_matches.assign(1, 0);
+    for (const Pattern &pattern : patterns) {
+        int32_t state = 0;
+        for (char byte : pattern.text) {
+            const std::size_t edge = static_cast<std::size_t>(state) * m_columns + m_columnForByte[static_cast<uint8_t>(byte)];
+            if (m_transitions[edge] < 0) {
+                m_transitions[edge] = static_cast<int32_t>(m_matches.size());
+                m_matches.push_back(0);
+                m_transitions.resize(m_transitions.size() + static_cast<std::size_t>(m_columns), -1);
+            }
+            state = m_transitions[edge];
+        }
+        m_matches[static_cast<std::size_t>(state)] |= pattern.match;
+    }
+
+    std::vector<int32_t> failure(m_matches.size(), 0);
+    std::deque<int32_t> queue;
+    for (int column = 0; column < m_columns; ++column) {
+        int32_t &next = m_transitions[static_cast<std::size_t>(column)];
+        if (next < 0) {
+            next = 0;
+        } else {
+            queue.push_back(next);
+        }
+    }
+
+    while (!queue.empty()) {
+        const int32_t state = queue.front();
+        queue.pop_front();
+        const std::size_t row = static_cast<std::size_t>(state) * m_columns;
+        const std::size_t failureRow = static_cast<std::size_t>(failure[static_cast<std::size_t>(state)]) * m_columns;
+        m_matches[static_cast<std::size_t>(state)] |= m_matches[static_cast<std::size_t>(failure[static_cast<std::size_t>(state)])];
+        for (int column = 0; column < m_columns; ++column) {
+            int32_t &next = m_transitions[row + column];
+            if (next < 0) {
+                next = m_transitions[failureRow + column];
+            } else {
+                failure[static_cast<std::size_t>(next)] = m_transitions[failureRow + column];
+                queue.push_back(next);
+            }
+        }
+    }
+}
+
+uint8_t BrandMatcher::scan(const QByteArray &text) const
+{
+    uint8_t matches = 0;
+    int32_t state = 0;
+    for (char byte : text) {
+        state = m_transitions[static_cast<std::size_t>(state) * m_columns + m_columnForByte[static_cast<uint8_t>(byte)]];
+        matches |= m_matches[static_cast<std::size_t>(state)];
+        if (matches & kBlockedMatch) {
+            break;
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Device filter compiled from the allow/block lists. Entries of the form "VID:PID" (hex)
+// are exact rules looked up in a hash; everything else is a case-insensitive substring of
+// the device name, and all substrings are matched together by one Aho-Corasick automaton,
+// so a check costs one pass over the name however long the lists are.
+class BrandMatcher
+{
+public:
+    BrandMatcher();
+    BrandMatcher(const QStringList &allowed, const QStringList &blocked);
+
+    // Blocked VID:PID, then blocked substrings, then the allow rules. Without any allow
+    // rules every device that is not blocked passes.
+    bool allows(const QString &name, quint32 vendor, quint32 product) const;
+
+    static bool parseDeviceId(const QString &entry, quint32 &vendor, quint32 &product);
+
+private:
+    enum Match : uint8_t {
+        kAllowedMatch = 1,
+        kBlockedMatch = 2
+    };
+
+    struct Pattern {
+        QByteArray text;
+        uint8_t match;
+    };
+
+    void compile(const std::vector<Pattern> &patterns);
+    uint8_t scan(const QByteArray &text) const;
+
+    // Bytes that occur in no pattern share column 0, which always leads back to the root.
+    std::array<uint16_t, 256> m_columnForByte{};
+    int m_columns{1};
+    std::vector<int32_t> m_transitions;
+    std::vector<uint8_t> m_matches;
+    QSet<quint64> m_allowedIds;
+    QSet<quint64> m_blockedIds;
+    bool m_hasAllowRules{false};
+};
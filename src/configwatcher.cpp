@@ -0,0 +1,70 @@
+#include "configwatcher.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+ConfigWatcher::ConfigWatcher(const QString &path, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_fileName(QFile::encodeName(QFileInfo(path).fileName()))
+    , m_settleTimer(new QTimer(this))
+{
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(kSettleMs);
+    connect(m_settleTimer, &QTimer::timeout, this, &ConfigWatcher::changed);
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    delete m_notifier;
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+}
+
+bool ConfigWatcher::start(QString &errorText)
+{
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        errorText = QStringLiteral("inotify_init1(): %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    const QByteArray directory = QFile::encodeName(QFileInfo(m_path).absolutePath());
+    if (inotify_add_watch(m_inotifyFd, directory.constData(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        errorText = QStringLiteral("inotify_add_watch(%1): %2").arg(QFile::decodeName(directory), QString::fromLocal8Bit(strerror(errno)));
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+        return false;
+    }
+
+    m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &ConfigWatcher::readEvents);
+    return true;
+}
+
+void ConfigWatcher::readEvents()
+{
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        const ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            if (event->len > 0 && m_fileName == event->name) {
+                m_settleTimer->start();
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+class QTimer;
+
+// Watches the INI file through inotify on its directory, so both in-place edits and the
+// temporary-file-and-rename writes QSettings does are seen. Bursts of events (an editor
+// saving, or our own write) are folded into one changed() signal.
+class ConfigWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int kSettleMs = 50;
+
+    explicit ConfigWatcher(const QString &path, QObject *parent = nullptr);
+    ~ConfigWatcher() override;
+
+    bool start(QString &errorText);
+
+signals:
+    void changed();
+
+private:
+    void readEvents();
+
+    QString m_path;
+    QByteArray m_fileName;
+    int m_inotifyFd{-1};
+    QSocketNotifier *m_notifier{nullptr};
+    QTimer *m_settleTimer{nullptr};
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+// Published by InputController through a SeqLock and polled by the UI; keep it POD.
+struct ControllerStatus {
+    enum class Phase : uint8_t {
+        Initialising,
+        Ready,
+        Active,
+        Holding,
+        Paused,
+        ActivationUpdated,
+        Stopped
+    };
+
+    uint64_t version{0};
+    uint64_t transitions{0};
+    uint64_t idleReleases{0};
+    Phase phase{Phase::Initialising};
+    bool activationHeld{false};
+    uint16_t activeKeycode{0};
+};
@@ -0,0 +1,335 @@
+#include "controlserver.h"
+
+#include "controllerstatus.h"
+#include "inputcontroller.h"
+#include "latencyhistogram.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+constexpr int kListenBacklog = 8;
+// A client that sends this much without a newline is not speaking the protocol.
+constexpr int kMaxLineLength = 4096;
+constexpr int kDefaultCalibrationMs = 5000;
+
+const char *phaseName(ControllerStatus::Phase phase)
+{
+    switch (phase) {
+    case ControllerStatus::Phase::Initialising:
+        return "initialising";
+    case ControllerStatus::Phase::Ready:
+        return "ready";
+    case ControllerStatus::Phase::Active:
+        return "active";
+    case ControllerStatus::Phase::Holding:
+        return "holding";
+    case ControllerStatus::Phase::Paused:
+        return "paused";
+    case ControllerStatus::Phase::ActivationUpdated:
+        return "activation-updated";
+    case ControllerStatus::Phase::Stopped:
+        return "stopped";
+    }
+    return "unknown";
+}
+
+QString systemError(const char *call)
+{
+    return QStringLiteral("%1: %2").arg(QString::fromLatin1(call), QString::fromLocal8Bit(strerror(errno)));
+}
+} // namespace
+
+ControlServer::ControlServer(InputController *controller, AppSettings *settings, QObject *parent)
+    : QObject(parent)
+    , m_controller(controller)
+    , m_settings(settings)
+{
+}
+
+ControlServer::~ControlServer()
+{
+    while (!m_clients.empty()) {
+        dropClient(m_clients.begin()->first);
+    }
+    delete m_listenNotifier;
+    if (m_listenFd >= 0) {
+        ::close(m_listenFd);
+        ::unlink(QFile::encodeName(m_path).constData());
+    }
+}
+
+QString ControlServer::defaultSocketPath()
+{
+    const QString runtimeDir = QString::fromLocal8Bit(qgetenv("XDG_RUNTIME_DIR"));
+    if (!runtimeDir.isEmpty()) {
+        return runtimeDir + QStringLiteral("/mouse-direction-binder.sock");
+    }
+    return QStringLiteral("/tmp/mouse-direction-binder-%1.sock").arg(getuid());
+}
+
+bool ControlServer::listen(const QString &path, QString &errorText)
+{
+    const QByteArray encodedPath = QFile::encodeName(path);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (encodedPath.isEmpty() || encodedPath.size() >= static_cast<qsizetype>(sizeof(address.sun_path))) {
+        errorText = QStringLiteral("Некоректний шлях сокета: %1").arg(path);
+        return false;
+    }
+    std::memcpy(address.sun_path, encodedPath.constData(), static_cast<std::size_t>(encodedPath.size()));
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        errorText = systemError("socket()");
+        return false;
+    }
+
+    // A socket file nobody answers on is left over from a crashed daemon.
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0) {
+        ::close(fd);
+        errorText = QStringLiteral("Інший екземпляр уже слухає %1").arg(path);
+        return false;
+    }
+    ::unlink(encodedPath.constData());
+
+    const mode_t previousMask = ::umask(0077);
+    const int bound = ::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+    ::umask(previousMask);
+    if (bound < 0 || ::listen(fd, kListenBacklog) < 0) {
+        errorText = systemError(bound < 0 ? "bind()" : "listen()");
+        ::close(fd);
+        return false;
+    }
+
+    m_listenFd = fd;
+    m_path = path;
+    m_listenNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_listenNotifier, &QSocketNotifier::activated, this, &ControlServer::acceptClients);
+    return true;
+}
+
+void ControlServer::broadcast(const QString &line)
+{
+    const QByteArray encoded = QStringLiteral("event %1\n").arg(line).toUtf8();
+    std::vector<int> failed;
+    for (auto &entry : m_clients) {
+        if (!sendLine(entry.second, encoded)) {
+            failed.push_back(entry.first);
+        }
+    }
+    for (int fd : failed) {
+        dropClient(fd);
+    }
+}
+
+void ControlServer::acceptClients()
+{
+    while (true) {
+        const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        Client client;
+        client.fd = fd;
+        client.notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(client.notifier, &QSocketNotifier::activated, this, [this, fd] { readClient(fd); });
+        m_clients.emplace(fd, std::move(client));
+    }
+}
+
+void ControlServer::readClient(int fd)
+{
+    auto found = m_clients.find(fd);
+    if (found == m_clients.end()) {
+        return;
+    }
+    Client &client = found->second;
+
+    char buffer[512];
+    while (true) {
+        const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            client.input.append(buffer, count);
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+            break;
+        }
+        dropClient(fd);
+        return;
+    }
+
+    qsizetype newline;
+    while ((newline = client.input.indexOf('\n')) >= 0) {
+        const QString line = QString::fromUtf8(client.input.left(newline)).trimmed();
+        client.input.remove(0, newline + 1);
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        bool closeClient = false;
+        const QString reply = handleCommand(line, closeClient);
+        if (!sendLine(client, (reply + QLatin1Char('\n')).toUtf8()) || closeClient) {
+            dropClient(fd);
+            return;
+        }
+    }
+
+    if (client.input.size() > kMaxLineLength) {
+        dropClient(fd);
+    }
+}
+
+void ControlServer::dropClient(int fd)
+{
+    auto found = m_clients.find(fd);
+    if (found == m_clients.end()) {
+        return;
+    }
+    // The notifier may be the one currently emitting; let the event loop delete it.
+    found->second.notifier->setEnabled(false);
+    found->second.notifier->deleteLater();
+    ::close(fd);
+    m_clients.erase(found);
+}
+
+bool ControlServer::sendLine(Client &client, const QByteArray &line)
+{
+    // Replies are short; a client that cannot take one line without blocking is dropped
+    // rather than buffered for.
+    const ssize_t written = ::send(client.fd, line.constData(), static_cast<std::size_t>(line.size()), MSG_NOSIGNAL | MSG_DONTWAIT);
+    return written == line.size();
+}
+
+QString ControlServer::handleCommand(const QString &line, bool &closeClient)
+{
+    const QStringList words = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    const QString command = words.first().toLower();
+
+    if (command == QStringLiteral("status")) {
+        const ControllerStatus status = m_controller->statusSnapshot();
+        return QStringLiteral("ok phase=%1 held=%2 key=%3 transitions=%4 idle-releases=%5")
+            .arg(QString::fromLatin1(phaseName(status.phase)))
+            .arg(status.activationHeld ? 1 : 0)
+            .arg(status.activeKeycode)
+            .arg(status.transitions)
+            .arg(status.idleReleases);
+    }
+
+    if (command == QStringLiteral("latency")) {
+        const LatencyHistogram::Summary summary = m_controller->latencyHistogram().summary();
+        return QStringLiteral("ok count=%1 p50=%2 p95=%3 p99=%4 max=%5")
+            .arg(summary.count)
+            .arg(summary.p50)
+            .arg(summary.p95)
+            .arg(summary.p99)
+            .arg(summary.max);
+    }
+
+    if (command == QStringLiteral("counters")) {
+        const QByteArray json = QJsonDocument(m_controller->runtimeCounters().toJson()).toJson(QJsonDocument::Compact);
+        return QStringLiteral("ok %1").arg(QString::fromUtf8(json));
+    }
+
+    if (command == QStringLiteral("activation") && words.size() == 2) {
+        bool ok = false;
+        const uint keycode = words.at(1).toUInt(&ok);
+        if (!ok || keycode == 0 || keycode > KEY_MAX) {
+            return QStringLiteral("error некоректний код клавіші");
+        }
+        m_settings->activationKey = keycode;
+        m_controller->setActivationKeycode(keycode);
+        emit settingsChanged();
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("randomizer") && words.size() == 2) {
+        const QString value = words.at(1).toLower();
+        if (value != QStringLiteral("on") && value != QStringLiteral("off")) {
+            return QStringLiteral("error очікується on або off");
+        }
+        m_settings->randomizerEnabled = (value == QStringLiteral("on"));
+        applyRandomizerSettings(*m_controller, *m_settings);
+        emit settingsChanged();
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("range") && words.size() == 3) {
+        bool minimumOk = false;
+        bool maximumOk = false;
+        int minimum = std::clamp(words.at(1).toInt(&minimumOk), 0, 100);
+        int maximum = std::clamp(words.at(2).toInt(&maximumOk), 0, 100);
+        if (!minimumOk || !maximumOk) {
+            return QStringLiteral("error очікуються два відсотки");
+        }
+        if (maximum < minimum) {
+            std::swap(minimum, maximum);
+        }
+        m_settings->randomizerMinimum = minimum;
+        m_settings->randomizerMaximum = maximum;
+        applyRandomizerSettings(*m_controller, *m_settings);
+        emit settingsChanged();
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("profile") && words.size() == 2) {
+        const auto found = std::find_if(m_settings->mappingProfiles.cbegin(), m_settings->mappingProfiles.cend(),
+                                        [&words](const MappingProfile &profile) {
+                                            return profile.name.compare(words.at(1), Qt::CaseInsensitive) == 0;
+                                        });
+        if (found == m_settings->mappingProfiles.cend()) {
+            return QStringLiteral("error невідомий профіль: %1").arg(words.at(1));
+        }
+        m_settings->mappingProfile = found->name;
+        applyLiveSettings(*m_controller, *m_settings);
+        emit settingsChanged();
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("calibrate") && words.size() <= 2) {
+        bool ok = true;
+        const int durationMs = words.size() == 2 ? words.at(1).toInt(&ok) : kDefaultCalibrationMs;
+        if (!ok || durationMs <= 0) {
+            return QStringLiteral("error некоректна тривалість");
+        }
+        m_controller->startCalibration(durationMs);
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("reset-latency")) {
+        m_controller->resetLatencyStatistics();
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("quit")) {
+        closeClient = true;
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("shutdown")) {
+        emit shutdownRequested();
+        return QStringLiteral("ok");
+    }
+
+    if (command == QStringLiteral("help")) {
+        return QStringLiteral("ok status latency counters activation <код> randomizer on|off range <мін> <макс> profile <назва> calibrate [мс] reset-latency quit shutdown");
+    }
+
+    return QStringLiteral("error невідома команда: %1").arg(line);
+}
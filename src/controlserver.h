@@ -0,0 +1,55 @@
+#pragma once
+
+#include "appsettings.h"
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+#include <unordered_map>
+
+class InputController;
+class QSocketNotifier;
+
+// Line-based control protocol for mdb-daemon over an AF_UNIX stream socket. Every command
+// gets exactly one "ok ..." or "error ..." reply; controller notifications are pushed to
+// all clients as "event ..." lines in between.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    ControlServer(InputController *controller, AppSettings *settings, QObject *parent = nullptr);
+    ~ControlServer() override;
+
+    static QString defaultSocketPath();
+
+    bool listen(const QString &path, QString &errorText);
+
+signals:
+    // The AppSettings passed in were changed by a client and should be persisted.
+    void settingsChanged();
+    void shutdownRequested();
+
+public slots:
+    void broadcast(const QString &line);
+
+private:
+    struct Client {
+        int fd{-1};
+        QSocketNotifier *notifier{nullptr};
+        QByteArray input;
+    };
+
+    void acceptClients();
+    void readClient(int fd);
+    void dropClient(int fd);
+    bool sendLine(Client &client, const QByteArray &line);
+    QString handleCommand(const QString &line, bool &closeClient);
+
+    InputController *m_controller{nullptr};
+    AppSettings *m_settings{nullptr};
+    int m_listenFd{-1};
+    QString m_path;
+    QSocketNotifier *m_listenNotifier{nullptr};
+    std::unordered_map<int, Client> m_clients;
+};
@@ -0,0 +1,205 @@
+#include "appsettings.h"
+#include "configwatcher.h"
+#include "controlserver.h"
+#include "inputcontroller.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+void printLine(const QString &line)
+{
+    std::fprintf(stderr, "%s\n", line.toLocal8Bit().constData());
+}
+
+// Client mode: sends one command and prints its reply, skipping pushed events.
+int sendCommand(const QString &socketPath, const QString &command)
+{
+    const QByteArray encodedPath = QFile::encodeName(socketPath);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (encodedPath.isEmpty() || encodedPath.size() >= static_cast<qsizetype>(sizeof(address.sun_path))) {
+        printLine(QStringLiteral("Некоректний шлях сокета: %1").arg(socketPath));
+        return 2;
+    }
+    std::memcpy(address.sun_path, encodedPath.constData(), static_cast<std::size_t>(encodedPath.size()));
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+        printLine(QStringLiteral("Не вдалося підключитися до %1: %2").arg(socketPath, QString::fromLocal8Bit(strerror(errno))));
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return 1;
+    }
+
+    QByteArray request = command.toUtf8();
+    request.append('\n');
+    if (::send(fd, request.constData(), static_cast<std::size_t>(request.size()), MSG_NOSIGNAL) != request.size()) {
+        printLine(QStringLiteral("Не вдалося надіслати команду: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        ::close(fd);
+        return 1;
+    }
+
+    QByteArray input;
+    char buffer[512];
+    while (true) {
+        qsizetype newline;
+        while ((newline = input.indexOf('\n')) >= 0) {
+            const QByteArray line = input.left(newline);
+            input.remove(0, newline + 1);
+            if (line.startsWith("event ")) {
+                continue;
+            }
+            std::printf("%s\n", line.constData());
+            ::close(fd);
+            return line.startsWith("ok") ? 0 : 1;
+        }
+
+        const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        input.append(buffer, count);
+    }
+
+    printLine(QStringLiteral("З'єднання закрито без відповіді."));
+    ::close(fd);
+    return 1;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Blocked before any thread starts so the controller thread inherits the mask and the
+    // signals are only ever seen through the signalfd below.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("mdb-daemon"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Mouse Direction Sync без графічного інтерфейсу"));
+    parser.addHelpOption();
+    const QCommandLineOption configOption(QStringLiteral("config"), QStringLiteral("INI-файл налаштувань."), QStringLiteral("файл"),
+                                          SettingsStore::defaultConfigPath());
+    const QCommandLineOption socketOption(QStringLiteral("socket"), QStringLiteral("Керуючий Unix-сокет."), QStringLiteral("шлях"),
+                                          ControlServer::defaultSocketPath());
+    const QCommandLineOption sendOption(QStringLiteral("send"), QStringLiteral("Надіслати команду запущеному демону й вийти."),
+                                        QStringLiteral("команда"));
+    parser.addOption(configOption);
+    parser.addOption(socketOption);
+    parser.addOption(sendOption);
+    parser.process(application);
+
+    if (parser.isSet(sendOption)) {
+        return sendCommand(parser.value(socketOption), parser.value(sendOption));
+    }
+
+    const int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd < 0) {
+        printLine(QStringLiteral("signalfd(): %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return 1;
+    }
+    QSocketNotifier signalNotifier(signalFd, QSocketNotifier::Read);
+    QObject::connect(&signalNotifier, &QSocketNotifier::activated, &application, [signalFd] {
+        signalfd_siginfo info{};
+        while (::read(signalFd, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+        }
+        QCoreApplication::quit();
+    });
+
+    SettingsStore store(parser.value(configOption));
+    AppSettings settings = store.load();
+    // load() only reads; this puts the defaults of anything missing into the file.
+    store.save(settings);
+
+    InputController controller;
+    ControlServer server(&controller, &settings);
+    QString errorText;
+    if (!server.listen(parser.value(socketOption), errorText)) {
+        printLine(errorText);
+        ::close(signalFd);
+        return 1;
+    }
+
+    QObject::connect(&server, &ControlServer::settingsChanged, &application, [&store, &settings] { store.save(settings); });
+    QObject::connect(&server, &ControlServer::shutdownRequested, &application, &QCoreApplication::quit, Qt::QueuedConnection);
+
+    QObject::connect(&controller, &InputController::statusChanged, &server, [&server](const QString &statusText) {
+        printLine(statusText);
+        server.broadcast(QStringLiteral("status %1").arg(statusText));
+    });
+    QObject::connect(&controller, &InputController::errorOccurred, &server, [&server](const QString &message) {
+        printLine(message);
+        server.broadcast(QStringLiteral("error %1").arg(message));
+    });
+    QObject::connect(&controller, &InputController::devicesDetected, &server, [&server](const QString &pointerName, const QString &keyboardName) {
+        server.broadcast(QStringLiteral("devices %1\t%2").arg(pointerName, keyboardName));
+    });
+    QObject::connect(&controller, &InputController::cachedDevicesChanged, &server,
+                     [&store, &settings](const CachedDevice &pointer, const CachedDevice &keyboard) {
+                         if (updateDeviceCache(settings, pointer, keyboard)) {
+                             store.save(settings);
+                         }
+                     });
+    QObject::connect(&controller, &InputController::realtimeStatusReported, &server,
+                     [](const QString &scheduling, const QString &affinity, const QString &memoryLock, const QString &timerSlack) {
+                         printLine(scheduling);
+                         printLine(affinity);
+                         printLine(memoryLock);
+                         printLine(timerSlack);
+                     });
+    // There is nobody to ask: the device needs an ACL or udev rule set up beforehand.
+    QObject::connect(&controller, &InputController::accessConfirmationRequested, &controller, [&controller](const QStringList &devicePaths) {
+        printLine(QStringLiteral("Немає доступу до %1; надайте права заздалегідь (setfacl або правило udev).").arg(devicePaths.join(QStringLiteral(", "))));
+        controller.deliverAccessConfirmation(false);
+    });
+    QObject::connect(&controller, &InputController::calibrationFinished, &server,
+                     [&server, &store, &settings](const QVector<DeviceCalibration> &calibrations) {
+                         mergeCalibrations(settings.calibrations, calibrations);
+                         store.save(settings);
+                         server.broadcast(QStringLiteral("calibration %1").arg(calibrations.size()));
+                     });
+
+    ConfigWatcher watcher(store.fileName());
+    QObject::connect(&watcher, &ConfigWatcher::changed, &controller, [&controller, &store, &settings] {
+        settings = store.load();
+        applyLiveSettings(controller, settings);
+    });
+    QString watchError;
+    if (!watcher.start(watchError)) {
+        printLine(QStringLiteral("Зміни INI-файлу не відстежуються: %1").arg(watchError));
+    }
+
+    configureController(controller, settings);
+    controller.start();
+
+    const int result = application.exec();
+
+    controller.stopController();
+    controller.wait();
+    ::close(signalFd);
+    return result;
+}
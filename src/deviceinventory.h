@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// One row per input device the controller currently knows about. The whole list is
+// published at most once per backend dispatch, so an enumeration or a hotplug storm costs
+// the GUI one update instead of one per device.
+struct DeviceInventoryEntry {
+    // InputDevice::id: assigned when the device is added, never 0.
+    quint32 id{0};
+    QString sysname;
+    QString devnode;
+    QString descriptor;
+    bool pointer{false};
+    bool keyboard{false};
+    bool pointerAllowed{false};
+    bool keyboardAllowed{false};
+    bool activePointer{false};
+    bool activeKeyboard{false};
+};
+
+using DeviceInventory = QVector<DeviceInventoryEntry>;
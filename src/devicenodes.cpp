@@ -0,0 +1,74 @@
+#include "devicenodes.h"
+
+#include <QFile>
+
+#include <libudev.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace
+{
+constexpr std::array<const char *, 4> kCandidateProperties = {
+    "ID_INPUT_MOUSE",
+    "ID_INPUT_TOUCHPAD",
+    "ID_INPUT_POINTINGSTICK",
+    "ID_INPUT_KEYBOARD",
+};
+} // namespace
+
+bool isPointerOrKeyboardNode(udev_device *device)
+{
+    const char *devnode = udev_device_get_devnode(device);
+    if (!devnode || std::strncmp(devnode, "/dev/input/event", 16) != 0) {
+        return false;
+    }
+    for (const char *property : kCandidateProperties) {
+        const char *value = udev_device_get_property_value(device, property);
+        if (value && std::strcmp(value, "1") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList pointerAndKeyboardNodes(udev *context)
+{
+    QStringList nodes;
+    udev_enumerate *enumerate = context ? udev_enumerate_new(context) : nullptr;
+    if (!enumerate) {
+        return nodes;
+    }
+
+    udev_enumerate_add_match_subsystem(enumerate, "input");
+    udev_enumerate_add_match_sysname(enumerate, "event*");
+    udev_enumerate_scan_devices(enumerate);
+
+    udev_list_entry *entry = nullptr;
+    udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+        udev_device *device = udev_device_new_from_syspath(context, udev_list_entry_get_name(entry));
+        if (!device) {
+            continue;
+        }
+        if (isPointerOrKeyboardNode(device)) {
+            nodes.append(QString::fromLocal8Bit(udev_device_get_devnode(device)));
+        }
+        udev_device_unref(device);
+    }
+    udev_enumerate_unref(enumerate);
+    return nodes;
+}
+
+QStringList inaccessibleNodes(const QStringList &paths)
+{
+    QStringList result;
+    for (const QString &path : paths) {
+        const QByteArray nativePath = QFile::encodeName(path);
+        if (access(nativePath.constData(), R_OK | W_OK) != 0 && (errno == EACCES || errno == EPERM)) {
+            result.append(path);
+        }
+    }
+    return result;
+}
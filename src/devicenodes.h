@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+struct udev;
+struct udev_device;
+
+// True for /dev/input/event* nodes udev tags as a mouse, touchpad, pointing stick or
+// keyboard: the same properties libinput uses, so nothing else on the seat is opened.
+bool isPointerOrKeyboardNode(udev_device *device);
+QStringList pointerAndKeyboardNodes(udev *context);
+
+// The subset of paths the current user cannot open for reading and writing right now.
+QStringList inaccessibleNodes(const QStringList &paths);
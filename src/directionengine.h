@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <utility>
+
+#include <linux/input-event-codes.h>
+
+enum class MotionResult : uint8_t {
+    Inactive,
+    BelowThreshold,
+    Rejected,
+    Applied
+};
+
+// Direction → key table, built once per mapping profile. Each axis contributes a sign
+// (0 below threshold, 1 negative, 2 positive) and keys[signX + 3 * signY] is the key to
+// hold; 0 releases. Without vertical keys signY stays 0 and the Y delta is never looked
+// at, so the single-axis case is one index into the first three entries.
+struct KeyMap {
+    static constexpr std::size_t kCells = 9;
+
+    std::array<uint16_t, kCells> keys{0, KEY_A, KEY_D};
+    bool usesY{false};
+
+    static constexpr std::size_t cell(unsigned signX, unsigned signY) { return signX + 3 * signY; }
+
+    // Diagonals left at 0 fall back to the horizontal key, then the vertical one.
+    static KeyMap fromDirections(uint16_t left, uint16_t right, uint16_t up, uint16_t down, uint16_t upLeft = 0,
+                                 uint16_t upRight = 0, uint16_t downLeft = 0, uint16_t downRight = 0)
+    {
+        KeyMap map;
+        map.keys = {0, left, right, up, upLeft, upRight, down, downLeft, downRight};
+        // Decided before the fallback below, which fills the diagonals of a horizontal-only map too.
+        map.usesY = std::any_of(map.keys.begin() + 3, map.keys.end(), [](uint16_t key) { return key != 0; });
+        for (unsigned signY = 1; signY <= 2; ++signY) {
+            for (unsigned signX = 1; signX <= 2; ++signX) {
+                uint16_t &key = map.keys[cell(signX, signY)];
+                if (key == 0) {
+                    key = map.keys[cell(signX, 0)] != 0 ? map.keys[cell(signX, 0)] : map.keys[cell(0, signY)];
+                }
+            }
+        }
+        return map;
+    }
+};
+
+struct DirectionState {
+    uint16_t activationKeycode{KEY_LEFTSHIFT};
+    bool activationPressed{false};
+    uint16_t heldKeycode{0};
+};
+
+struct FixedThreshold {
+    static constexpr double kThreshold = 0.4;
+
+    bool passes(double deltaX) const { return std::fabs(deltaX) >= kThreshold; }
+};
+
+// Threshold chosen at runtime, e.g. from a per-device calibration; set before handleMotion().
+struct DeviceThreshold {
+    double value{FixedThreshold::kThreshold};
+
+    bool passes(double deltaX) const { return std::fabs(deltaX) >= value; }
+};
+
+struct NoRandomizer {
+    bool accept() { return true; }
+};
+
+// Accepts a motion with a probability drawn uniformly from [minimum, maximum] percent.
+class PercentRandomizer
+{
+public:
+    PercentRandomizer(uint32_t seed, int minimumPercent, int maximumPercent)
+        : m_engine(seed)
+        , m_unit(0.0, 1.0)
+    {
+        setRange(minimumPercent, maximumPercent);
+    }
+
+    void setRange(int minimumPercent, int maximumPercent)
+    {
+        m_minimum = std::clamp(minimumPercent, 0, 100);
+        m_maximum = std::clamp(maximumPercent, 0, 100);
+        if (m_maximum < m_minimum) {
+            std::swap(m_minimum, m_maximum);
+        }
+    }
+
+    bool accept()
+    {
+        if (m_maximum == 0) {
+            return false;
+        }
+
+        std::uniform_int_distribution<int> percentDistribution(m_minimum, m_maximum);
+        const double probability = static_cast<double>(percentDistribution(m_engine)) / 100.0;
+        return m_unit(m_engine) <= probability;
+    }
+
+private:
+    std::mt19937 m_engine;
+    std::uniform_real_distribution<double> m_unit;
+    int m_minimum{0};
+    int m_maximum{100};
+};
+
+// Qt-free motion → key decision core. Sink is any type with
+// applyTransition(uint16_t releasedKeycode, uint16_t pressedKeycode); either keycode may be 0
+// and a direction flip reports both in one call. All policy calls resolve at compile time,
+// so the NoRandomizer instantiation has no per-event indirection at all.
+template<typename ThresholdPolicy, typename RandomizerPolicy, typename Sink>
+class DirectionEngine
+{
+public:
+    explicit DirectionEngine(Sink sink, ThresholdPolicy threshold = {}, RandomizerPolicy randomizer = {}, DirectionState state = {},
+                             KeyMap keyMap = {})
+        : m_sink(std::move(sink))
+        , m_threshold(std::move(threshold))
+        , m_randomizer(std::move(randomizer))
+        , m_state(state)
+        , m_keyMap(keyMap)
+    {
+    }
+
+    const DirectionState &state() const { return m_state; }
+    const KeyMap &keyMap() const { return m_keyMap; }
+    Sink &sink() { return m_sink; }
+    ThresholdPolicy &threshold() { return m_threshold; }
+    RandomizerPolicy &randomizer() { return m_randomizer; }
+
+    // A held key that is no longer mapped the same way is released first.
+    void setKeyMap(const KeyMap &keyMap)
+    {
+        m_keyMap = keyMap;
+        releaseActiveKey();
+    }
+
+    void setActivationKeycode(uint16_t keycode)
+    {
+        m_state.activationKeycode = keycode;
+        resetActivation();
+    }
+
+    // Returns true when the activation state changed.
+    bool handleKey(uint32_t keycode, bool pressed)
+    {
+        if (keycode != m_state.activationKeycode || pressed == m_state.activationPressed) {
+            return false;
+        }
+
+        m_state.activationPressed = pressed;
+        if (!pressed) {
+            releaseActiveKey();
+        }
+        return true;
+    }
+
+    MotionResult handleMotion(double deltaX, double rawDeltaX, double deltaY = 0.0, double rawDeltaY = 0.0)
+    {
+        if (!m_state.activationPressed) {
+            releaseActiveKey();
+            return MotionResult::Inactive;
+        }
+
+        const std::size_t cell = directionCell(deltaX, rawDeltaX, deltaY, rawDeltaY);
+        if (cell == 0) {
+            return MotionResult::BelowThreshold;
+        }
+
+        if (!m_randomizer.accept()) {
+            releaseActiveKey();
+            return MotionResult::Rejected;
+        }
+
+        const uint16_t keycode = m_keyMap.keys[cell];
+        if (keycode != 0) {
+            pressKey(keycode);
+        } else {
+            releaseActiveKey();
+        }
+        return MotionResult::Applied;
+    }
+
+    // The key handleMotion() would hold for this motion, ignoring activation and the
+    // randomizer; 0 when the motion is below threshold or the direction is unmapped.
+    uint16_t keyFor(double deltaX, double rawDeltaX, double deltaY = 0.0, double rawDeltaY = 0.0) const
+    {
+        return m_keyMap.keys[directionCell(deltaX, rawDeltaX, deltaY, rawDeltaY)];
+    }
+
+    // Whether coalesced motion may move the held key elsewhere: switching to another key
+    // needs the net |delta| on a used axis to reach hysteresis; releasing or keeping it does not.
+    bool passesHysteresis(double deltaX, double rawDeltaX, double deltaY, double rawDeltaY, double hysteresis) const
+    {
+        const uint16_t held = m_state.heldKeycode;
+        if (held == 0) {
+            return true;
+        }
+        const uint16_t target = keyFor(deltaX, rawDeltaX, deltaY, rawDeltaY);
+        if (target == 0 || target == held) {
+            return true;
+        }
+        double magnitude = std::max(std::fabs(deltaX), std::fabs(rawDeltaX));
+        if (m_keyMap.usesY) {
+            magnitude = std::max({magnitude, std::fabs(deltaY), std::fabs(rawDeltaY)});
+        }
+        return magnitude >= hysteresis;
+    }
+
+    void releaseActiveKey()
+    {
+        if (m_state.heldKeycode == 0) {
+            return;
+        }
+
+        const uint16_t released = m_state.heldKeycode;
+        m_state.heldKeycode = 0;
+        m_sink.applyTransition(released, 0);
+    }
+
+    void resetActivation()
+    {
+        m_state.activationPressed = false;
+        releaseActiveKey();
+    }
+
+private:
+    unsigned axisSign(double delta, double rawDelta) const
+    {
+        if (std::fabs(rawDelta) > std::fabs(delta)) {
+            delta = rawDelta;
+        }
+        if (delta == 0.0 || !m_threshold.passes(delta)) {
+            return 0;
+        }
+        return delta < 0.0 ? 1 : 2;
+    }
+
+    std::size_t directionCell(double deltaX, double rawDeltaX, double deltaY, double rawDeltaY) const
+    {
+        std::size_t cell = axisSign(deltaX, rawDeltaX);
+        if (m_keyMap.usesY) {
+            cell += 3 * axisSign(deltaY, rawDeltaY);
+        }
+        return cell;
+    }
+
+    void pressKey(uint16_t keycode)
+    {
+        if (m_state.heldKeycode == keycode) {
+            return;
+        }
+
+        const uint16_t released = m_state.heldKeycode;
+        m_state.heldKeycode = keycode;
+        m_sink.applyTransition(released, keycode);
+    }
+
+    Sink m_sink;
+    ThresholdPolicy m_threshold;
+    RandomizerPolicy m_randomizer;
+    DirectionState m_state;
+    KeyMap m_keyMap;
+};
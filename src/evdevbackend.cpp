@@ -0,0 +1,340 @@
+#include "evdevbackend.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace
+{
+template<std::size_t Bits>
+using BitArray = std::array<unsigned long, (Bits + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))>;
+
+constexpr unsigned int kWordBits = 8 * sizeof(unsigned long);
+
+template<std::size_t Bits>
+bool testBit(const BitArray<Bits> &bits, unsigned int bit)
+{
+    return (bits[bit / kWordBits] >> (bit % kWordBits)) & 1UL;
+}
+
+template<std::size_t Bits>
+void setBit(BitArray<Bits> &bits, unsigned int bit, bool value)
+{
+    const unsigned long mask = 1UL << (bit % kWordBits);
+    bits[bit / kWordBits] = value ? (bits[bit / kWordBits] | mask) : (bits[bit / kWordBits] & ~mask);
+}
+
+uint64_t eventTimeUsec(const input_event &event)
+{
+    return static_cast<uint64_t>(event.input_event_sec) * 1000000ULL + static_cast<uint64_t>(event.input_event_usec);
+}
+}
+
+EvdevBackend::EvdevBackend(InputBackendHost &host, const QStringList &devicePaths)
+    : InputBackend(host)
+    , m_devicePaths(devicePaths)
+{
+}
+
+EvdevBackend::~EvdevBackend()
+{
+    close();
+}
+
+QStringList EvdevBackend::candidatePaths() const
+{
+    if (!m_devicePaths.isEmpty()) {
+        return m_devicePaths;
+    }
+
+    QStringList paths;
+    const QDir inputDir(QStringLiteral("/dev/input"));
+    for (const QString &entry : inputDir.entryList({QStringLiteral("event*")}, QDir::System)) {
+        paths.append(inputDir.filePath(entry));
+    }
+    return paths;
+}
+
+bool EvdevBackend::open(QString &errorText)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        errorText = QStringLiteral("Не вдалося створити epoll: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    for (const QString &path : candidatePaths()) {
+        openNode(path);
+    }
+
+    // Nodes still waiting for an access grant count: they are opened once it arrives.
+    if (m_nodes.empty() && m_deniedPaths.isEmpty()) {
+        errorText = QStringLiteral("Не знайдено придатних пристроїв evdev.");
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void EvdevBackend::reopenDevices(const QStringList &devicePaths)
+{
+    for (const QString &path : devicePaths) {
+        if (m_deniedPaths.contains(path)) {
+            openNode(path);
+        }
+    }
+}
+
+void EvdevBackend::close()
+{
+    for (const std::unique_ptr<Node> &node : m_nodes) {
+        ::close(node->fd);
+    }
+    m_nodes.clear();
+    m_deniedPaths.clear();
+
+    if (m_epollFd >= 0) {
+        ::close(m_epollFd);
+        m_epollFd = -1;
+    }
+}
+
+bool EvdevBackend::openNode(const QString &path)
+{
+    const QByteArray nativePath = path.toLocal8Bit();
+    int fd = ::open(nativePath.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+        if (m_host.requestDeviceAccess(path)) {
+            fd = ::open(nativePath.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        }
+        if (fd < 0 && !m_deniedPaths.contains(path)) {
+            m_deniedPaths.append(path);
+        }
+    }
+    if (fd < 0) {
+        return false;
+    }
+    m_deniedPaths.removeAll(path);
+
+    BitArray<EV_MAX + 1> eventBits{};
+    BitArray<REL_MAX + 1> relativeBits{};
+    BitArray<KEY_MAX + 1> keyBits{};
+    ioctl(fd, EVIOCGBIT(0, sizeof(eventBits)), eventBits.data());
+    if (testBit<EV_MAX + 1>(eventBits, EV_REL)) {
+        ioctl(fd, EVIOCGBIT(EV_REL, sizeof(relativeBits)), relativeBits.data());
+    }
+    if (testBit<EV_MAX + 1>(eventBits, EV_KEY)) {
+        ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits.data());
+    }
+
+    auto node = std::make_unique<Node>();
+    node->fd = fd;
+    node->device.pointer = testBit<REL_MAX + 1>(relativeBits, REL_X);
+    node->device.keyboard = testBit<KEY_MAX + 1>(keyBits, KEY_A) || testBit<KEY_MAX + 1>(keyBits, KEY_LEFTSHIFT);
+    if (!node->device.pointer && !node->device.keyboard) {
+        ::close(fd);
+        return false;
+    }
+    if (node->device.keyboard) {
+        ioctl(fd, EVIOCGKEY(sizeof(node->keysDown)), node->keysDown.data());
+    }
+
+    char name[256] = {};
+    ioctl(fd, EVIOCGNAME(sizeof(name) - 1), name);
+    input_id id{};
+    ioctl(fd, EVIOCGID, &id);
+    node->device.name = QString::fromLocal8Bit(name);
+    node->device.sysname = QFileInfo(path).fileName();
+    node->device.devnode = path;
+    node->device.vendor = id.vendor;
+    node->device.product = id.product;
+
+    // Match libinput's timestamps so both backends report CLOCK_MONOTONIC microseconds.
+    int clockId = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clockId);
+
+    epoll_event registration{};
+    registration.events = EPOLLIN;
+    registration.data.ptr = node.get();
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &registration) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    m_nodes.push_back(std::move(node));
+
+    InputEvent added;
+    added.type = InputEvent::Type::DeviceAdded;
+    added.device = &m_nodes.back()->device;
+    m_host.handleInputEvent(added);
+    return true;
+}
+
+bool EvdevBackend::dispatch(QString &errorText)
+{
+    std::array<epoll_event, 16> ready{};
+    for (;;) {
+        const int count = epoll_wait(m_epollFd, ready.data(), static_cast<int>(ready.size()), 0);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            errorText = QStringLiteral("Помилка epoll_wait(): %1").arg(QString::fromLocal8Bit(strerror(errno)));
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            auto *node = static_cast<Node *>(ready[i].data.ptr);
+            if (!readNode(*node)) {
+                removeNode(node);
+            }
+        }
+
+        if (count < static_cast<int>(ready.size())) {
+            return true;
+        }
+    }
+}
+
+bool EvdevBackend::readNode(Node &node)
+{
+    for (;;) {
+        const ssize_t bytes = read(node.fd, m_buffer.data(), sizeof(m_buffer));
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (bytes == 0) {
+            return false;
+        }
+
+        const std::size_t count = static_cast<std::size_t>(bytes) / sizeof(input_event);
+        for (std::size_t i = 0; i < count; ++i) {
+            translateEvent(node, m_buffer[i]);
+        }
+
+        if (static_cast<std::size_t>(bytes) < sizeof(m_buffer)) {
+            return true;
+        }
+    }
+}
+
+void EvdevBackend::translateEvent(Node &node, const input_event &event)
+{
+    if (event.type == EV_SYN) {
+        if (event.code == SYN_DROPPED) {
+            node.dropping = true;
+            node.pendingDx = 0.0;
+            node.pendingDy = 0.0;
+            node.pendingMotion = false;
+            return;
+        }
+        if (event.code != SYN_REPORT) {
+            return;
+        }
+        if (node.dropping) {
+            node.dropping = false;
+            resyncKeys(node, eventTimeUsec(event));
+            return;
+        }
+        if (node.pendingMotion) {
+            InputEvent motion;
+            motion.type = InputEvent::Type::PointerMotion;
+            motion.device = &node.device;
+            motion.timeUsec = eventTimeUsec(event);
+            motion.dx = node.pendingDx;
+            motion.dxUnaccelerated = node.pendingDx;
+            motion.dy = node.pendingDy;
+            motion.dyUnaccelerated = node.pendingDy;
+            node.pendingDx = 0.0;
+            node.pendingDy = 0.0;
+            node.pendingMotion = false;
+            m_host.handleInputEvent(motion);
+        }
+        return;
+    }
+
+    if (node.dropping) {
+        return;
+    }
+
+    if (event.type == EV_REL && (event.code == REL_X || event.code == REL_Y) && node.device.pointer) {
+        // Raw sensor counts: unlike libinput there is no 1000 dpi normalisation, so the
+        // per-device threshold has to be calibrated under this backend (see README).
+        (event.code == REL_X ? node.pendingDx : node.pendingDy) += event.value;
+        node.pendingMotion = true;
+        return;
+    }
+
+    if (event.type == EV_KEY && node.device.keyboard && event.value != 2) {
+        if (event.code <= KEY_MAX) {
+            setBit<KEY_MAX + 1>(node.keysDown, event.code, event.value == 1);
+        }
+        InputEvent key;
+        key.type = InputEvent::Type::KeyboardKey;
+        key.device = &node.device;
+        key.timeUsec = eventTimeUsec(event);
+        key.key = event.code;
+        key.pressed = (event.value == 1);
+        m_host.handleInputEvent(key);
+    }
+}
+
+// Key transitions lost in the overflow would leave the activation key held (or A/D
+// pressed) until it is tapped again, so the difference to the kernel's state is replayed.
+void EvdevBackend::resyncKeys(Node &node, uint64_t timeUsec)
+{
+    if (!node.device.keyboard) {
+        return;
+    }
+
+    KeyBits current{};
+    if (ioctl(node.fd, EVIOCGKEY(sizeof(current)), current.data()) < 0) {
+        return;
+    }
+
+    for (std::size_t word = 0; word < current.size(); ++word) {
+        unsigned long changed = current[word] ^ node.keysDown[word];
+        while (changed != 0) {
+            const auto bit = static_cast<unsigned int>(__builtin_ctzl(changed));
+            changed &= changed - 1;
+
+            InputEvent key;
+            key.type = InputEvent::Type::KeyboardKey;
+            key.device = &node.device;
+            key.timeUsec = timeUsec;
+            key.key = static_cast<uint32_t>(word * kWordBits + bit);
+            key.pressed = (current[word] >> bit) & 1UL;
+            m_host.handleInputEvent(key);
+        }
+    }
+    node.keysDown = current;
+}
+
+void EvdevBackend::removeNode(Node *node)
+{
+    InputEvent removed;
+    removed.type = InputEvent::Type::DeviceRemoved;
+    removed.device = &node->device;
+    m_host.handleInputEvent(removed);
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, node->fd, nullptr);
+    ::close(node->fd);
+    m_nodes.erase(std::remove_if(m_nodes.begin(), m_nodes.end(),
+                                 [node](const std::unique_ptr<Node> &entry) { return entry.get() == node; }),
+                  m_nodes.end());
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "inputbackend.h"
+
+#include <QStringList>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <linux/input.h>
+
+// Reads REL_X/REL_Y/EV_KEY straight from /dev/input/eventN nodes, bypassing libinput's
+// per-event processing. Deltas are reported raw (dx == dxUnaccelerated).
+class EvdevBackend : public InputBackend
+{
+public:
+    EvdevBackend(InputBackendHost &host, const QStringList &devicePaths);
+    ~EvdevBackend() override;
+
+    Kind kind() const override { return Kind::Evdev; }
+    bool open(QString &errorText) override;
+    void close() override;
+    int fd() const override { return m_epollFd; }
+    bool dispatch(QString &errorText) override;
+    QStringList requiredNodes() override { return candidatePaths(); }
+    void reopenDevices(const QStringList &devicePaths) override;
+    bool hasOpenDevices() const override { return !m_nodes.empty(); }
+
+private:
+    using KeyBits = std::array<unsigned long, (KEY_MAX + 8 * sizeof(unsigned long)) / (8 * sizeof(unsigned long))>;
+
+    struct Node {
+        int fd{-1};
+        InputDevice device;
+        double pendingDx{0.0};
+        double pendingDy{0.0};
+        bool pendingMotion{false};
+        bool dropping{false};
+        // Keys down as of the last event read, to resynchronise after SYN_DROPPED.
+        KeyBits keysDown{};
+    };
+
+    QStringList candidatePaths() const;
+    bool openNode(const QString &path);
+    bool readNode(Node &node);
+    void translateEvent(Node &node, const input_event &event);
+    void resyncKeys(Node &node, uint64_t timeUsec);
+    void removeNode(Node *node);
+
+    QStringList m_devicePaths;
+    // Nodes that failed with EACCES/EPERM, retried by reopenDevices().
+    QStringList m_deniedPaths;
+    int m_epollFd{-1};
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    std::array<input_event, 128> m_buffer{};
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include <cstdint>
+
+struct InputDevice {
+    QString name;
+    QString sysname;
+    QString devnode;
+    quint32 vendor{0};
+    quint32 product{0};
+    bool pointer{false};
+    bool keyboard{false};
+
+    // Owned by InputController: filled in once when the device is added and again
+    // whenever the brand filters change, so per-event checks are plain flag reads.
+    QString descriptor;
+    bool pointerAllowed{false};
+    bool keyboardAllowed{false};
+    // The trace deviceId and the inventory id. Assigned in sequence and never 0, which means
+    // "no device"; an id only comes round again after 65535 further additions.
+    uint16_t id{0};
+    // The pointer's line in InputController's PointerStateTable.
+    uint8_t stateSlot{0};
+};
+
+// The last pointer/keyboard node the controller settled on, persisted so the next start
+// can open just that node. Event numbers are reassigned on replug and reboot, so a node
+// only counts while its name, vendor and product still match.
+struct CachedDevice {
+    QString node;
+    QString name;
+    quint32 vendor{0};
+    quint32 product{0};
+};
+
+struct InputEvent {
+    enum class Type : uint8_t {
+        DeviceAdded,
+        DeviceRemoved,
+        PointerMotion,
+        PointerMotionAbsolute,
+        KeyboardKey
+    };
+
+    Type type{Type::PointerMotion};
+    InputDevice *device{nullptr};
+    uint64_t timeUsec{0};
+    double dx{0.0};
+    double dxUnaccelerated{0.0};
+    double dy{0.0};
+    double dyUnaccelerated{0.0};
+    // PointerMotionAbsolute only, in mm; the deltas are left at zero for the controller to
+    // derive from the previous position.
+    double absoluteX{0.0};
+    double absoluteY{0.0};
+    uint32_t key{0};
+    bool pressed{false};
+};
+
+class InputBackendHost
+{
+public:
+    // Must not block on the user. false means the node is unavailable for now; once access
+    // is granted the backend is asked to retry it through reopenDevices().
+    virtual bool requestDeviceAccess(const QString &devicePath) = 0;
+    virtual void handleInputEvent(const InputEvent &event) = 0;
+
+protected:
+    ~InputBackendHost() = default;
+};
+
+// A source of pointer/keyboard events for InputController. The backend exposes a single
+// pollable descriptor; dispatch() drains whatever is readable and forwards it to the host.
+// InputDevice pointers stay valid until the matching DeviceRemoved event has been handled.
+class InputBackend
+{
+public:
+    enum class Kind {
+        Libinput,
+        Evdev,
+        Synthetic
+    };
+
+    explicit InputBackend(InputBackendHost &host)
+        : m_host(host)
+    {
+    }
+    virtual ~InputBackend() = default;
+
+    InputBackend(const InputBackend &) = delete;
+    InputBackend &operator=(const InputBackend &) = delete;
+
+    virtual Kind kind() const = 0;
+    virtual bool open(QString &errorText) = 0;
+    virtual void close() = 0;
+    virtual int fd() const = 0;
+    virtual bool dispatch(QString &errorText) = 0;
+
+    // Nodes open() is going to try, so access to all of them can be asked for at once.
+    virtual QStringList requiredNodes() { return {}; }
+    // Called once access to previously refused nodes has been granted. DeviceAdded events
+    // are delivered either from inside this call or from the next dispatch().
+    virtual void reopenDevices(const QStringList &devicePaths) { Q_UNUSED(devicePaths); }
+    // false when open() succeeded without a single input node, e.g. all of them are
+    // waiting for an access grant.
+    virtual bool hasOpenDevices() const { return true; }
+
+protected:
+    InputBackendHost &m_host;
+};
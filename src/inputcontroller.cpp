@@ -1,35 +1,50 @@
 #include "inputcontroller.h"
 
+#include "devicenodes.h"
+#include "evdevbackend.h"
+#include "libinputbackend.h"
+#include "probes.h"
+
+#include <QFile>
 #include <QMutexLocker>
 #include <QString>
 #include <QStringList>
 #include <QtGlobal>
 
-#include <libinput.h>
-#include <libudev.h>
-
 #include <cerrno>
-#include <cmath>
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <fcntl.h>
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
-#include <sys/time.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
+#include <utility>
 
 #include <linux/uinput.h>
 #include <array>
 
 namespace
 {
-constexpr double kMotionThreshold = 0.4;
-constexpr auto kIdleReleaseInterval = std::chrono::milliseconds(150);
+constexpr char kUinputPath[] = "/dev/uinput";
+// Absolute positions arrive in mm; thresholds are in libinput's normalised 1000 dpi units.
+constexpr double kAbsoluteUnitsPerMm = 1000.0 / 25.4;
 
-const libinput_interface kInterface = {
-    .open_restricted = &InputController::openRestricted,
-    .close_restricted = &InputController::closeRestricted,
-};
+quint64 calibrationKey(quint32 vendor, quint32 product)
+{
+    return (static_cast<quint64>(vendor) << 32) | product;
+}
+
+QHash<quint64, CalibrationResult> calibrationTable(const QVector<DeviceCalibration> &calibrations)
+{
+    QHash<quint64, CalibrationResult> table;
+    for (const DeviceCalibration &calibration : calibrations) {
+        table.insert(calibrationKey(calibration.vendor, calibration.product), calibration.result);
+    }
+    return table;
+}
 
 const std::array<const char *, 15> kDefaultPointerBrands = {
     "logitech", "steelseries", "razer", "asus", "synaptics",
@@ -50,85 +65,134 @@ const std::array<const char *, 14> kDefaultKeyboardBrands = {
 const std::array<const char *, 6> kDefaultKeyboardBlocked = {
     "virtual", "uinput", "seat", "test", "dummy", "mousedirectionbinder"
 };
+
+template<std::size_t N>
+QStringList defaultBrands(const std::array<const char *, N> &brands)
+{
+    QStringList values;
+    values.reserve(static_cast<qsizetype>(N));
+    for (const char *brand : brands) {
+        values.append(QString::fromUtf8(brand));
+    }
+    return values;
+}
 }
 
 InputController::InputController(QObject *parent)
     : QThread(parent)
-    , m_unitDistribution(0.0, 1.0)
+    , m_producerThread(QThread::currentThread())
+    , m_engine(std::in_place_type<PlainEngine>, UinputSink{this})
 {
-    std::random_device device;
-    m_randomEngine.seed(device());
+    m_coalescedSlots.reserve(static_cast<int>(PointerStateTable::kCapacity));
     m_lastMotion = std::chrono::steady_clock::now();
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
-    for (const char *brand : kDefaultPointerBrands) {
-        const QString value = QString::fromUtf8(brand).trimmed().toLower();
-        if (!value.isEmpty()) {
-            m_pointerAllowedBrands.append(value);
-        }
-    }
-    for (const char *brand : kDefaultPointerBlocked) {
-        const QString value = QString::fromUtf8(brand).trimmed().toLower();
-        if (!value.isEmpty()) {
-            m_pointerBlockedBrands.append(value);
-        }
-    }
-    for (const char *brand : kDefaultKeyboardBrands) {
-        const QString value = QString::fromUtf8(brand).trimmed().toLower();
-        if (!value.isEmpty()) {
-            m_keyboardAllowedBrands.append(value);
-        }
-    }
-    for (const char *brand : kDefaultKeyboardBlocked) {
-        const QString value = QString::fromUtf8(brand).trimmed().toLower();
-        if (!value.isEmpty()) {
-            m_keyboardBlockedBrands.append(value);
-        }
-    }
-
-    m_pointerAllowedBrands.removeDuplicates();
-    m_pointerBlockedBrands.removeDuplicates();
-    m_keyboardAllowedBrands.removeDuplicates();
-    m_keyboardBlockedBrands.removeDuplicates();
+    m_pointerFilter = BrandMatcher(defaultBrands(kDefaultPointerBrands), defaultBrands(kDefaultPointerBlocked));
+    m_keyboardFilter = BrandMatcher(defaultBrands(kDefaultKeyboardBrands), defaultBrands(kDefaultKeyboardBlocked));
 }
 
 InputController::~InputController()
 {
     stopController();
     wait();
+
+    ControllerCommand command;
+    while (m_commands.tryPop(command)) {
+        delete command.filters;
+        delete command.snapshot;
+    }
+
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
 }
 
 void InputController::stopController()
 {
     requestInterruption();
-    {
-        QMutexLocker locker(&m_accessMutex);
-        if (m_accessDecisionPending) {
-            m_accessDecisionPending = false;
-            m_accessGranted = false;
-            m_accessWait.wakeAll();
-        }
-    }
+
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::Shutdown;
+    postCommand(command);
+}
+
+void InputController::setInputBackend(InputBackend::Kind kind, const QStringList &evdevDevicePaths)
+{
+    m_preferredBackend = kind;
+    m_evdevDevicePaths = evdevDevicePaths;
+}
+
+void InputController::setBackendFactory(BackendFactory factory)
+{
+    m_backendFactory = std::move(factory);
+}
+
+void InputController::setVirtualDeviceEnabled(bool enabled)
+{
+    m_virtualDeviceEnabled = enabled;
+}
+
+void InputController::setTraceRecording(const QString &path, quint64 capacity)
+{
+    m_tracePath = path;
+    m_traceCapacity = capacity;
+}
+
+void InputController::setRealtimeOptions(const RealtimeOptions &options)
+{
+    m_realtimeOptions = options;
+}
+
+void InputController::setDeviceCalibrations(const QVector<DeviceCalibration> &calibrations)
+{
+    m_calibrations = calibrationTable(calibrations);
+}
+
+void InputController::setCachedDevices(const QVector<CachedDevice> &devices)
+{
+    m_cachedDevices = devices;
+}
+
+void InputController::setMappedKeys(const QVector<uint16_t> &keycodes)
+{
+    m_uinputKeys = keycodes;
+}
+
+void InputController::setMotionCoalescing(bool enabled, double hysteresis)
+{
+    m_coalesceMotion = enabled;
+    m_coalesceHysteresis = std::max(0.0, hysteresis);
+}
+
+ControllerStatus InputController::statusSnapshot() const
+{
+    return m_publishedStatus.load();
 }
 
 void InputController::setActivationKeycode(quint32 keycode)
 {
-    QMutexLocker locker(&m_activationMutex);
-    m_pendingActivationKeycode = static_cast<uint16_t>(keycode);
-    m_activationDirty = true;
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::ActivationKey;
+    command.keycode = static_cast<uint16_t>(keycode);
+    postCommand(command);
 }
 
 void InputController::setRandomizerEnabled(bool enabled)
 {
-    m_randomizerEnabled.store(enabled, std::memory_order_relaxed);
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::RandomizerEnabled;
+    command.enabled = enabled;
+    postCommand(command);
 }
 
 void InputController::setRandomizerRange(int minimumPercent, int maximumPercent)
 {
-    minimumPercent = std::clamp(minimumPercent, 0, 100);
-    maximumPercent = std::clamp(maximumPercent, 0, 100);
-
-    m_randomizerMinimum.store(minimumPercent, std::memory_order_relaxed);
-    m_randomizerMaximum.store(maximumPercent, std::memory_order_relaxed);
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::RandomizerRange;
+    command.minimum = std::clamp(minimumPercent, 0, 100);
+    command.maximum = std::clamp(maximumPercent, 0, 100);
+    postCommand(command);
 }
 
 namespace
@@ -145,86 +209,183 @@ QStringList normalisedBrands(const QStringList &input)
     }
     return output;
 }
+
+// Our own virtual device is always blocked, whatever the lists say.
+BrandMatcher compiledFilter(const QStringList &allowed, const QStringList &blocked)
+{
+    QStringList blockedWithSelf = normalisedBrands(blocked);
+    if (!blockedWithSelf.contains(QStringLiteral("mousedirectionbinder"))) {
+        blockedWithSelf.append(QStringLiteral("mousedirectionbinder"));
+    }
+    return BrandMatcher(normalisedBrands(allowed), blockedWithSelf);
+}
 }
 
 void InputController::setPointerBrandFilters(const QStringList &allowed, const QStringList &blocked)
 {
-    QMutexLocker locker(&m_deviceMutex);
-    m_pointerAllowedBrands = normalisedBrands(allowed);
-    m_pointerBlockedBrands = normalisedBrands(blocked);
-    if (!m_pointerBlockedBrands.contains(QStringLiteral("mousedirectionbinder"))) {
-        m_pointerBlockedBrands.append(QStringLiteral("mousedirectionbinder"));
-    }
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::PointerFilters;
+    command.filters = new BrandFilters{compiledFilter(allowed, blocked)};
+    postCommand(command);
 }
 
 void InputController::setKeyboardBrandFilters(const QStringList &allowed, const QStringList &blocked)
 {
-    QMutexLocker locker(&m_deviceMutex);
-    m_keyboardAllowedBrands = normalisedBrands(allowed);
-    m_keyboardBlockedBrands = normalisedBrands(blocked);
-    if (!m_keyboardBlockedBrands.contains(QStringLiteral("mousedirectionbinder"))) {
-        m_keyboardBlockedBrands.append(QStringLiteral("mousedirectionbinder"));
-    }
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::KeyboardFilters;
+    command.filters = new BrandFilters{compiledFilter(allowed, blocked)};
+    postCommand(command);
 }
 
-void InputController::deliverAccessConfirmation(bool granted)
+void InputController::applyLiveConfig(const LiveConfig &config)
 {
-    QMutexLocker locker(&m_accessMutex);
-    if (!m_accessDecisionPending) {
-        return;
-    }
-    m_accessGranted = granted;
-    m_accessDecisionPending = false;
-    m_accessWait.wakeAll();
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::LiveConfig;
+    command.keycode = static_cast<uint16_t>(config.activationKeycode);
+    command.enabled = config.randomizerEnabled;
+    command.minimum = std::clamp(config.randomizerMinimum, 0, 100);
+    command.maximum = std::clamp(config.randomizerMaximum, 0, 100);
+    command.snapshot = new LiveSnapshot{compiledFilter(config.pointerAllowedBrands, config.pointerBlockedBrands),
+                                        compiledFilter(config.keyboardAllowedBrands, config.keyboardBlockedBrands),
+                                        calibrationTable(config.calibrations), config.keyMap};
+    postCommand(command);
 }
 
-int InputController::openRestricted(const char *path, int flags, void *userData)
+void InputController::resetLatencyStatistics()
 {
-    auto *controller = static_cast<InputController *>(userData);
-    const QString devicePath = QString::fromLocal8Bit(path);
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::ResetLatency;
+    postCommand(command);
+}
 
-    for (;;) {
-        int fd = open(path, flags | O_CLOEXEC);
-        if (fd >= 0) {
-            return fd;
-        }
+void InputController::startCalibration(int durationMs)
+{
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::StartCalibration;
+    command.durationMs = std::max(durationMs, 1000);
+    postCommand(command);
+}
 
-        const int error = errno;
-        if (!controller || (error != EACCES && error != EPERM)) {
-            return -error;
-        }
+void InputController::postCommand(const ControllerCommand &command)
+{
+    Q_ASSERT_X(QThread::currentThread() == m_producerThread, "InputController::postCommand",
+               "commands must come from the thread that created the controller");
+    // The queue only overflows when the controller thread is not draining it (never
+    // started or already failed); the command would have no effect then anyway.
+    if (!m_commands.push(command)) {
+        delete command.filters;
+        delete command.snapshot;
+        return;
+    }
+    wakeEventLoop();
+}
 
-        if (!controller->requestDeviceAccess(devicePath)) {
-            return -error;
+bool InputController::drainCommands()
+{
+    ControllerCommand command;
+    while (m_commands.tryPop(command)) {
+        switch (command.type) {
+        case ControllerCommand::Type::ActivationKey:
+            applyActivationKeycode(command.keycode);
+            break;
+        case ControllerCommand::Type::RandomizerEnabled:
+            applyRandomizerEnabled(command.enabled);
+            break;
+        case ControllerCommand::Type::RandomizerRange:
+            applyRandomizerRange(command.minimum, command.maximum);
+            break;
+        case ControllerCommand::Type::PointerFilters:
+            m_pointerFilter = std::move(command.filters->matcher);
+            delete command.filters;
+            reclassifyDevices();
+            break;
+        case ControllerCommand::Type::KeyboardFilters:
+            m_keyboardFilter = std::move(command.filters->matcher);
+            delete command.filters;
+            reclassifyDevices();
+            break;
+        case ControllerCommand::Type::LiveConfig:
+            m_pointerFilter = std::move(command.snapshot->pointerFilter);
+            m_keyboardFilter = std::move(command.snapshot->keyboardFilter);
+            m_calibrations = std::move(command.snapshot->calibrations);
+            applyKeyMap(command.snapshot->keyMap);
+            delete command.snapshot;
+            reclassifyDevices();
+            if (command.keycode != directionState().activationKeycode) {
+                applyActivationKeycode(command.keycode);
+            }
+            applyRandomizerRange(command.minimum, command.maximum);
+            applyRandomizerEnabled(command.enabled);
+            break;
+        case ControllerCommand::Type::ResetLatency:
+            m_latency.reset();
+            break;
+        case ControllerCommand::Type::StartCalibration:
+            beginCalibration(command.durationMs);
+            break;
+        case ControllerCommand::Type::AccessDecision:
+            if (!applyAccessDecision(command.enabled)) {
+                return false;
+            }
+            break;
+        case ControllerCommand::Type::Shutdown:
+            return false;
         }
     }
+    return true;
 }
 
-void InputController::closeRestricted(int fd, void *userData)
+void InputController::deliverAccessConfirmation(bool granted)
 {
-    Q_UNUSED(userData);
-    if (fd >= 0) {
-        close(fd);
+    {
+        QMutexLocker locker(&m_accessMutex);
+        if (!m_accessPending) {
+            return;
+        }
+        m_accessPending = false;
+        // Moved out here, so a node that asks for access before the controller has applied
+        // this answer starts a new prompt instead of overwriting the answered one.
+        (granted ? m_accessGranted : m_accessRefused).append(m_accessBatch);
+        m_accessBatch.clear();
     }
+
+    ControllerCommand command;
+    command.type = ControllerCommand::Type::AccessDecision;
+    command.enabled = granted;
+    postCommand(command);
 }
 
 bool InputController::setupUinput()
 {
-    m_uinputFd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
-    if (m_uinputFd < 0) {
-        if ((errno == EACCES || errno == EPERM) && requestDeviceAccess(QStringLiteral("/dev/uinput"))) {
-            m_uinputFd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (!m_virtualDeviceEnabled) {
+        m_uinputFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (m_uinputFd < 0) {
+            emit errorOccurred(QStringLiteral("Не вдалося відкрити /dev/null: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            return false;
+        }
+        return true;
+    }
+
+    m_uinputFd = open(kUinputPath, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    const int openError = errno;
+    if (m_uinputFd < 0 && (openError == EACCES || openError == EPERM)) {
+        // Frames are dropped until the prompt is answered; applyAccessDecision() retries.
+        requestDeviceAccess(QString::fromLatin1(kUinputPath));
+        if (isAccessPending(QString::fromLatin1(kUinputPath))) {
+            return true;
         }
     }
 
     if (m_uinputFd < 0) {
-        emit errorOccurred(QStringLiteral("Не вдалося відкрити /dev/uinput: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        emit errorOccurred(QStringLiteral("Не вдалося відкрити /dev/uinput: %1").arg(QString::fromLocal8Bit(strerror(openError))));
         return false;
     }
 
-    if (ioctl(m_uinputFd, UI_SET_EVBIT, EV_KEY) < 0 ||
-        ioctl(m_uinputFd, UI_SET_KEYBIT, m_keycodeA) < 0 ||
-        ioctl(m_uinputFd, UI_SET_KEYBIT, m_keycodeD) < 0) {
+    bool keysRegistered = ioctl(m_uinputFd, UI_SET_EVBIT, EV_KEY) >= 0;
+    for (const uint16_t keycode : std::as_const(m_uinputKeys)) {
+        keysRegistered = keysRegistered && ioctl(m_uinputFd, UI_SET_KEYBIT, keycode) >= 0;
+    }
+    if (!keysRegistered) {
         emit errorOccurred(QStringLiteral("Не вдалося налаштувати клавіші uinput: %1").arg(QString::fromLocal8Bit(strerror(errno))));
         teardownUinput();
         return false;
@@ -255,555 +416,1072 @@ bool InputController::setupUinput()
 void InputController::teardownUinput()
 {
     if (m_uinputFd >= 0) {
-        ioctl(m_uinputFd, UI_DEV_DESTROY);
+        if (m_virtualDeviceEnabled) {
+            ioctl(m_uinputFd, UI_DEV_DESTROY);
+        }
         close(m_uinputFd);
         m_uinputFd = -1;
     }
 }
 
-bool InputController::setupLibinput()
+bool InputController::setupBackend()
+{
+    InputBackendHost &host = *this;
+    QString errorText;
+    if (m_backendFactory) {
+        m_backend = m_backendFactory(host);
+        if (!m_backend || !m_backend->open(errorText)) {
+            m_backend.reset();
+            emit errorOccurred(errorText);
+            return false;
+        }
+        return true;
+    }
+
+    // One prompt for everything the chosen backend and uinput are about to open. A libinput
+    // fallback after evdev asks for its own leftovers through requestDeviceAccess().
+    bool accessRequested = false;
+    if (m_preferredBackend == InputBackend::Kind::Evdev) {
+        m_backend = std::make_unique<EvdevBackend>(host, m_evdevDevicePaths);
+        requestAccessBatch(m_backend->requiredNodes());
+        accessRequested = true;
+        if (m_backend->open(errorText)) {
+            if (m_backend->hasOpenDevices() || isAnyAccessPending()) {
+                return true;
+            }
+            errorText = QStringLiteral("Доступ до жодного пристрою evdev не надано.");
+            m_backend->close();
+        }
+        emit statusChanged(QStringLiteral("%1 Використовується libinput.").arg(errorText));
+        m_backend.reset();
+    }
+
+    auto libinputBackend = std::make_unique<LibinputBackend>(host);
+    libinputBackend->setCachedDevices(m_cachedDevices);
+    m_backend = std::move(libinputBackend);
+    if (!accessRequested) {
+        requestAccessBatch(m_backend->requiredNodes());
+    }
+    if (!m_backend->open(errorText)) {
+        m_backend.reset();
+        emit errorOccurred(errorText);
+        return false;
+    }
+    return true;
+}
+
+void InputController::teardownBackend()
 {
-    m_udev = udev_new();
-    if (!m_udev) {
-        emit errorOccurred(QStringLiteral("Не вдалося створити контекст udev."));
+    if (m_backend) {
+        m_backend->close();
+        m_backend.reset();
+    }
+    m_devices.clear();
+    m_pointerStates.clear();
+    m_coalescedSlots.clear();
+    m_motionOwner = kNoMotionOwner;
+    m_pointerDevice = nullptr;
+    m_keyboardDevice = nullptr;
+}
+
+void InputController::setupTraceRecorder()
+{
+    if (m_tracePath.isEmpty()) {
+        return;
+    }
+
+    if (!m_trace.open(QFile::encodeName(m_tracePath).constData(), m_traceCapacity)) {
+        emit errorOccurred(QStringLiteral("Не вдалося відкрити файл трасування %1: %2")
+                               .arg(m_tracePath, QString::fromLocal8Bit(strerror(errno))));
+        return;
+    }
+
+    emit statusChanged(QStringLiteral("Запис трасування у %1").arg(m_tracePath));
+}
+
+bool InputController::setupEventLoop()
+{
+    if (m_wakeFd < 0) {
+        emit errorOccurred(QStringLiteral("Не вдалося створити eventfd: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return false;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        emit errorOccurred(QStringLiteral("Не вдалося створити epoll: %1").arg(QString::fromLocal8Bit(strerror(errno))));
         return false;
     }
 
-    m_libinput = libinput_udev_create_context(&kInterface, this, m_udev);
-    if (!m_libinput) {
-        emit errorOccurred(QStringLiteral("Не вдалося створити контекст libinput. Переконайтеся, що маєте доступ до /dev/input/*."));
-        udev_unref(m_udev);
-        m_udev = nullptr;
+    m_idleTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_idleTimerFd < 0) {
+        emit errorOccurred(QStringLiteral("Не вдалося створити timerfd: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        teardownEventLoop();
         return false;
     }
 
-    if (libinput_udev_assign_seat(m_libinput, "seat0") != 0) {
-        emit errorOccurred(QStringLiteral("Не вдалося підключитися до seat0. Перевірте доступ seatd чи запустіть додаток з sudo."));
-        libinput_unref(m_libinput);
-        m_libinput = nullptr;
-        udev_unref(m_udev);
-        m_udev = nullptr;
+    m_calibrationTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_calibrationTimerFd < 0) {
+        emit errorOccurred(QStringLiteral("Не вдалося створити timerfd: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        teardownEventLoop();
         return false;
     }
 
-    libinput_dispatch(m_libinput);
+    const std::array<int, 4> descriptors = {m_backend->fd(), m_idleTimerFd, m_calibrationTimerFd, m_wakeFd};
+    for (int fd : descriptors) {
+        epoll_event registration{};
+        registration.events = EPOLLIN;
+        registration.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &registration) < 0) {
+            emit errorOccurred(QStringLiteral("Не вдалося зареєструвати дескриптор в epoll: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+            teardownEventLoop();
+            return false;
+        }
+    }
+
+    m_idleTimerArmed = false;
     return true;
 }
 
-void InputController::teardownLibinput()
+void InputController::teardownEventLoop()
 {
-    if (m_libinput) {
-        libinput_unref(m_libinput);
-        m_libinput = nullptr;
+    if (m_idleTimerFd >= 0) {
+        close(m_idleTimerFd);
+        m_idleTimerFd = -1;
+    }
+    if (m_calibrationTimerFd >= 0) {
+        close(m_calibrationTimerFd);
+        m_calibrationTimerFd = -1;
     }
-    if (m_udev) {
-        udev_unref(m_udev);
-        m_udev = nullptr;
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+        m_epollFd = -1;
     }
+    m_idleTimerArmed = false;
+}
+
+void InputController::wakeEventLoop()
+{
+    if (m_wakeFd < 0) {
+        return;
+    }
+
+    const uint64_t increment = 1;
+    while (write(m_wakeFd, &increment, sizeof(increment)) < 0 && errno == EINTR) {
+    }
+}
+
+void InputController::armIdleTimer()
+{
+    if (m_idleTimerFd < 0) {
+        return;
+    }
+
+    // steady_clock is CLOCK_MONOTONIC on Linux, so the deadline can be handed to timerfd as-is.
+    const auto deadline = std::chrono::duration_cast<std::chrono::nanoseconds>((m_lastMotion + m_idleReleaseInterval).time_since_epoch());
+    itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(deadline.count() / 1000000000);
+    spec.it_value.tv_nsec = static_cast<long>(deadline.count() % 1000000000);
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+        spec.it_value.tv_nsec = 1;
+    }
+
+    if (timerfd_settime(m_idleTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr) == 0) {
+        m_idleTimerArmed = true;
+    }
+}
+
+void InputController::disarmIdleTimer()
+{
+    if (m_idleTimerFd < 0 || !m_idleTimerArmed) {
+        return;
+    }
+
+    const itimerspec spec{};
+    timerfd_settime(m_idleTimerFd, 0, &spec, nullptr);
+    m_idleTimerArmed = false;
+}
+
+void InputController::handleIdleTimer()
+{
+    m_idleTimerArmed = false;
+    if (directionState().heldKeycode == 0) {
+        return;
+    }
+
+    // Motion keeps moving m_lastMotion forward without touching the timer; re-arm lazily
+    // so a continuous drag costs one timerfd_settime() per idle interval, not per event.
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_lastMotion < m_idleReleaseInterval) {
+        armIdleTimer();
+        return;
+    }
+
+    m_traceRecord = m_trace.begin();
+    if (m_traceRecord) {
+        m_traceRecord->timeUsec = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count());
+        m_traceRecord->type = TraceEventType::IdleRelease;
+    }
+    std::visit([](auto &engine) { engine.releaseActiveKey(); }, m_engine);
+    if (m_traceRecord) {
+        m_traceRecord = nullptr;
+        m_trace.commit();
+    }
+    ++m_status.idleReleases;
+    m_counters.increment(RuntimeCounters::IdleReleases);
+    publishStatus(ControllerStatus::Phase::Paused);
 }
 
 void InputController::run()
 {
     emit statusChanged(QStringLiteral("Ініціалізація пристроїв..."));
 
+    // The backend goes first so the access prompt can cover its nodes and /dev/uinput at once.
+    if (!setupBackend()) {
+        return;
+    }
     if (!setupUinput()) {
+        teardownBackend();
         return;
     }
-    if (!setupLibinput()) {
+    setupTraceRecorder();
+
+    if (!setupEventLoop()) {
+        m_trace.close();
+        teardownBackend();
         teardownUinput();
         return;
     }
 
-    emit statusChanged(QStringLiteral("Готово. Затисніть клавішу активації."));
+    const RealtimeReport realtime = applyRealtimeOptions(m_realtimeOptions);
+    emit realtimeStatusReported(realtime.scheduling, realtime.affinity, realtime.memoryLock, realtime.timerSlack);
+
+    publishStatus(ControllerStatus::Phase::Ready);
 
-    pollfd descriptors[1];
-    descriptors[0].fd = libinput_get_fd(m_libinput);
-    descriptors[0].events = POLLIN;
+    bool running = drainCommands();
+    publishDevices();
 
-    while (!isInterruptionRequested()) {
-        applyPendingActivation();
+    const int backendFd = m_backend->fd();
+    std::array<epoll_event, 4> ready{};
 
-        int ret = poll(descriptors, 1, 50);
-        if (ret < 0) {
+    while (running && !isInterruptionRequested()) {
+        const int count = epoll_wait(m_epollFd, ready.data(), static_cast<int>(ready.size()), -1);
+        if (count < 0) {
             if (errno == EINTR) {
                 continue;
             }
-            emit errorOccurred(QStringLiteral("Помилка poll(): %1").arg(QString::fromLocal8Bit(strerror(errno))));
-            break;
-        }
-
-        if (ret > 0 && (descriptors[0].revents & (POLLERR | POLLHUP))) {
-            emit errorOccurred(QStringLiteral("Втрачено з'єднання з пристроєм введення."));
+            emit errorOccurred(QStringLiteral("Помилка epoll_wait(): %1").arg(QString::fromLocal8Bit(strerror(errno))));
             break;
         }
-
-        if (ret > 0 && (descriptors[0].revents & POLLIN)) {
-            libinput_dispatch(m_libinput);
-            libinput_event *event = nullptr;
-            while ((event = libinput_get_event(m_libinput)) != nullptr) {
-                processEvent(event);
-                libinput_event_destroy(event);
+        m_counters.increment(RuntimeCounters::LoopWakeups);
+
+        for (int i = 0; i < count && running; ++i) {
+            const int fd = ready[i].data.fd;
+            const uint32_t mask = ready[i].events;
+
+            if (fd == m_wakeFd) {
+                uint64_t counter = 0;
+                while (read(m_wakeFd, &counter, sizeof(counter)) < 0 && errno == EINTR) {
+                }
+                running = drainCommands();
+            } else if (fd == m_idleTimerFd) {
+                uint64_t expirations = 0;
+                while (read(m_idleTimerFd, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {
+                }
+                handleIdleTimer();
+            } else if (fd == m_calibrationTimerFd) {
+                uint64_t expirations = 0;
+                while (read(m_calibrationTimerFd, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {
+                }
+                if (m_calibrating) {
+                    finishCalibration();
+                }
+            } else if (fd == backendFd) {
+                if (mask & (EPOLLERR | EPOLLHUP)) {
+                    emit errorOccurred(QStringLiteral("Втрачено з'єднання з пристроєм введення."));
+                    running = false;
+                    break;
+                }
+
+                QString errorText;
+                const bool dispatched = m_backend->dispatch(errorText);
+                flushCoalescedMotion();
+                if (!dispatched) {
+                    emit errorOccurred(errorText);
+                    running = false;
+                    break;
+                }
             }
         }
-
-        const auto now = std::chrono::steady_clock::now();
-        if (m_currentlyPressedKeycode != 0 && now - m_lastMotion > kIdleReleaseInterval) {
-            releaseActiveKey();
-            emit statusChanged(QStringLiteral("Призупинено."));
-        }
+        // Once per wakeup: whatever the dispatch or the commands added, removed or
+        // reclassified goes out as a single update.
+        publishDevices();
     }
 
-    releaseActiveKey();
-    teardownLibinput();
+    std::visit([](auto &engine) { engine.resetActivation(); }, m_engine);
+    publishStatus(ControllerStatus::Phase::Stopped);
+    m_trace.close();
+    teardownEventLoop();
+    teardownBackend();
     teardownUinput();
 }
 
-void InputController::applyPendingActivation()
+void InputController::applyActivationKeycode(uint16_t keycode)
 {
-    bool dirty = false;
-    uint16_t keycode = KEY_LEFTSHIFT;
-    {
-        QMutexLocker locker(&m_activationMutex);
-        if (m_activationDirty) {
-            keycode = m_pendingActivationKeycode;
-            m_activationDirty = false;
-            dirty = true;
-        }
+    if (keycode == 0) {
+        emit errorOccurred(QStringLiteral("Обрана клавіша недоступна."));
+        return;
     }
 
-    if (!dirty) {
+    std::visit([keycode](auto &engine) { engine.setActivationKeycode(keycode); }, m_engine);
+    disarmIdleTimer();
+    publishStatus(ControllerStatus::Phase::ActivationUpdated);
+}
+
+void InputController::applyRandomizerEnabled(bool enabled)
+{
+    const bool active = std::holds_alternative<RandomizedEngine>(m_engine);
+    if (enabled == active) {
         return;
     }
 
-    if (keycode == 0) {
-        emit errorOccurred(QStringLiteral("Обрана клавіша недоступна."));
+    const DirectionState state = directionState();
+    const KeyMap map = keyMap();
+    if (enabled) {
+        m_engine.emplace<RandomizedEngine>(UinputSink{this}, DeviceThreshold{},
+                                           PercentRandomizer(std::random_device{}(), m_randomizerMinimum, m_randomizerMaximum),
+                                           state, map);
+    } else {
+        m_engine.emplace<PlainEngine>(UinputSink{this}, DeviceThreshold{}, NoRandomizer{}, state, map);
+    }
+}
+
+void InputController::applyRandomizerRange(int minimum, int maximum)
+{
+    m_randomizerMinimum = minimum;
+    m_randomizerMaximum = maximum;
+    if (auto *engine = std::get_if<RandomizedEngine>(&m_engine)) {
+        engine->randomizer().setRange(minimum, maximum);
+    }
+}
+
+void InputController::applyKeyMap(const KeyMap &map)
+{
+    if (map.keys == keyMap().keys) {
         return;
     }
 
-    m_activationKeycode.store(keycode, std::memory_order_relaxed);
-    m_activationPressed = false;
-    releaseActiveKey();
-    emit statusChanged(QStringLiteral("Клавіша активації оновлена."));
+    // The uinput device only advertises the keys it was set up with; a key added since
+    // would be dropped by the kernel, so keep the old map until the next start().
+    if (m_uinputFd >= 0 && m_virtualDeviceEnabled) {
+        for (const uint16_t keycode : map.keys) {
+            if (keycode != 0 && !m_uinputKeys.contains(keycode)) {
+                emit errorOccurred(QStringLiteral("Клавіша %1 не зареєстрована у віртуальному пристрої; профіль буде застосовано після перезапуску.").arg(keycode));
+                return;
+            }
+        }
+    }
+
+    std::visit([&map](auto &engine) { engine.setKeyMap(map); }, m_engine);
+    disarmIdleTimer();
+}
+
+const KeyMap &InputController::keyMap() const
+{
+    return std::visit([](const auto &engine) -> const KeyMap & { return engine.keyMap(); }, m_engine);
+}
+
+const DirectionState &InputController::directionState() const
+{
+    return std::visit([](const auto &engine) -> const DirectionState & { return engine.state(); }, m_engine);
+}
+
+void InputController::handleInputEvent(const InputEvent &event)
+{
+    processEvent(event);
 }
 
-void InputController::processEvent(libinput_event *event)
+void InputController::processEvent(const InputEvent &event)
 {
-    switch (libinput_event_get_type(event)) {
-    case LIBINPUT_EVENT_POINTER_MOTION:
-        handlePointerMotion(libinput_event_get_pointer_event(event));
+    MDB_PROBE3(event_received, event.timeUsec, event.device ? event.device->id : 0, static_cast<int>(event.type));
+
+    // Keys and hotplug must observe the motion that preceded them in the batch.
+    if (!m_coalescedSlots.isEmpty() && event.type != InputEvent::Type::PointerMotion &&
+        event.type != InputEvent::Type::PointerMotionAbsolute) {
+        flushCoalescedMotion();
+    }
+
+    m_traceRecord = m_trace.begin();
+    if (m_traceRecord) {
+        m_traceRecord->timeUsec = event.timeUsec;
+        m_traceRecord->type = static_cast<TraceEventType>(event.type);
+        m_traceRecord->dx = static_cast<float>(event.dx);
+        m_traceRecord->dxUnaccelerated = static_cast<float>(event.dxUnaccelerated);
+        m_traceRecord->key = static_cast<uint16_t>(event.key);
+        m_traceRecord->pressed = event.pressed ? 1 : 0;
+    }
+
+    switch (event.type) {
+    case InputEvent::Type::PointerMotion:
+        m_counters.increment(RuntimeCounters::PointerMotionEvents);
+        handlePointerMotion(event);
         break;
-    case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-        handlePointerMotion(libinput_event_get_pointer_event(event));
+    case InputEvent::Type::PointerMotionAbsolute:
+        m_counters.increment(RuntimeCounters::AbsoluteMotionEvents);
+        handlePointerMotion(event);
         break;
-    case LIBINPUT_EVENT_KEYBOARD_KEY:
-        handleKeyboardKey(libinput_event_get_keyboard_event(event));
+    case InputEvent::Type::KeyboardKey:
+        m_counters.increment(RuntimeCounters::KeyboardKeyEvents);
+        handleKeyboardKey(event);
         break;
-    case LIBINPUT_EVENT_DEVICE_ADDED:
+    case InputEvent::Type::DeviceAdded:
+        m_counters.increment(RuntimeCounters::DeviceAddedEvents);
         handleDeviceAdded(event);
         break;
-    case LIBINPUT_EVENT_DEVICE_REMOVED:
+    case InputEvent::Type::DeviceRemoved:
+        m_counters.increment(RuntimeCounters::DeviceRemovedEvents);
         handleDeviceRemoved(event);
         break;
-    default:
-        break;
     }
-}
+    m_frameSourceUsec = 0;
+    m_frameDeviceId = 0;
 
-void InputController::handlePointerMotion(libinput_event_pointer *pointerEvent)
-{
-    if (!pointerEvent) {
-        return;
+    if (m_traceRecord) {
+        m_traceRecord->deviceId = event.device ? event.device->id : 0;
+        m_traceRecord = nullptr;
+        m_trace.commit();
     }
+}
 
-    libinput_event *baseEvent = libinput_event_pointer_get_base_event(pointerEvent);
-    libinput_device *device = baseEvent ? libinput_event_get_device(baseEvent) : nullptr;
-    if (!isPointerDeviceAllowed(device)) {
+void InputController::handlePointerMotion(const InputEvent &event)
+{
+    const InputDevice *device = event.device;
+    if (!device || !device->pointerAllowed) {
+        m_counters.increment(RuntimeCounters::FilteredPointerEvents);
         return;
     }
 
     updatePointerDevice(device);
 
-    if (!m_activationPressed) {
-        releaseActiveKey();
-        return;
+    const uint8_t slot = device->stateSlot;
+    PointerState &state = m_pointerStates[slot];
+    const uint64_t previousUsec = state.lastTimeUsec;
+    const uint16_t previousDeviceId = state.deviceId;
+    state.lastTimeUsec = event.timeUsec;
+    state.deviceId = device->id;
+
+    double deltaX = event.dx;
+    double rawDeltaX = event.dxUnaccelerated;
+    double deltaY = event.dy;
+    double rawDeltaY = event.dyUnaccelerated;
+    if (event.type == InputEvent::Type::PointerMotionAbsolute) {
+        const auto x = static_cast<float>(event.absoluteX);
+        const auto y = static_cast<float>(event.absoluteY);
+        // After a pause (out of proximity, pointer re-grabbed) or in a slot another device
+        // wrote last, the old position is no anchor: the jump would read as one huge delta.
+        const bool hadPosition = state.hasAbsolute && previousDeviceId == device->id &&
+            event.timeUsec - previousUsec <= static_cast<uint64_t>(state.idleReleaseMs) * 1000;
+        const float previousX = state.absoluteX;
+        const float previousY = state.absoluteY;
+        state.absoluteX = x;
+        state.absoluteY = y;
+        state.hasAbsolute = true;
+        // A new anchor only prepares the next delta.
+        if (!hadPosition) {
+            return;
+        }
+        deltaX = (x - previousX) * kAbsoluteUnitsPerMm;
+        deltaY = (y - previousY) * kAbsoluteUnitsPerMm;
+        rawDeltaX = deltaX;
+        rawDeltaY = deltaY;
+        if (m_traceRecord) {
+            m_traceRecord->dx = static_cast<float>(deltaX);
+            m_traceRecord->dxUnaccelerated = static_cast<float>(rawDeltaX);
+        }
     }
 
-    double deltaX = libinput_event_pointer_get_dx(pointerEvent);
-    const double rawDeltaX = libinput_event_pointer_get_dx_unaccelerated(pointerEvent);
-    if (std::fabs(rawDeltaX) > std::fabs(deltaX)) {
-        deltaX = rawDeltaX;
+    if (m_calibrating) {
+        recordCalibrationSample(device, event.timeUsec, deltaX, rawDeltaX);
     }
 
-    if (std::fabs(deltaX) < kMotionThreshold) {
+    if (m_coalesceMotion) {
+        if (!state.pending) {
+            state.pending = true;
+            state.pendingSinceUsec = event.timeUsec;
+            state.pendingDx = 0.0f;
+            state.pendingDxUnaccelerated = 0.0f;
+            state.pendingDy = 0.0f;
+            state.pendingDyUnaccelerated = 0.0f;
+            m_coalescedSlots.append(slot);
+        }
+        state.pendingDx += static_cast<float>(deltaX);
+        state.pendingDxUnaccelerated += static_cast<float>(rawDeltaX);
+        state.pendingDy += static_cast<float>(deltaY);
+        state.pendingDyUnaccelerated += static_cast<float>(rawDeltaY);
         return;
     }
 
-    m_lastMotion = std::chrono::steady_clock::now();
+    m_frameSourceUsec = event.timeUsec;
+    m_frameDeviceId = device->id;
+    applyMotion(slot, deltaX, rawDeltaX, deltaY, rawDeltaY);
+}
 
-    if (!shouldApplyMotion()) {
-        releaseActiveKey();
-        return;
+void InputController::applyMotion(uint8_t slot, double deltaX, double rawDeltaX, double deltaY, double rawDeltaY)
+{
+    const uint64_t sourceUsec = m_frameSourceUsec;
+    const uint16_t heldBefore = directionState().heldKeycode;
+    if (heldBefore != 0 && m_motionOwner != kNoMotionOwner && m_motionOwner != slot) {
+        const PointerState &owner = m_pointerStates[m_motionOwner];
+        if (sourceUsec < owner.lastTimeUsec + static_cast<uint64_t>(owner.idleReleaseMs) * 1000) {
+            m_counters.increment(RuntimeCounters::PointerArbitrationRejections);
+            return;
+        }
     }
 
-    if (deltaX < 0.0) {
-        pressKey(m_keycodeA);
-    } else if (deltaX > 0.0) {
-        pressKey(m_keycodeD);
+    const PointerState &state = m_pointerStates[slot];
+    m_idleReleaseInterval = std::chrono::milliseconds(state.idleReleaseMs);
+
+    const double threshold = state.motionThreshold;
+    const MotionResult result = std::visit(
+        [deltaX, rawDeltaX, deltaY, rawDeltaY, threshold](auto &engine) {
+            engine.threshold().value = threshold;
+            return engine.handleMotion(deltaX, rawDeltaX, deltaY, rawDeltaY);
+        },
+        m_engine);
+    MDB_PROBE4(motion_decision, sourceUsec, state.deviceId, static_cast<int>(result), directionState().heldKeycode);
+    if (m_traceRecord) {
+        m_traceRecord->motionResult = static_cast<uint8_t>(result);
+    }
+    if (result == MotionResult::BelowThreshold) {
+        m_counters.increment(RuntimeCounters::ThresholdRejections);
+    } else if (result == MotionResult::Rejected) {
+        m_counters.increment(RuntimeCounters::RandomizerRejections);
+    }
+    if (result == MotionResult::Rejected || result == MotionResult::Applied) {
+        m_lastMotion = std::chrono::steady_clock::now();
+    }
+
+    const uint16_t heldAfter = directionState().heldKeycode;
+    if (heldAfter == 0) {
+        m_motionOwner = kNoMotionOwner;
+    } else if (result == MotionResult::Applied) {
+        m_motionOwner = slot;
+    }
+    if (m_telemetryEnabled.load(std::memory_order_relaxed)) {
+        TelemetrySample sample;
+        sample.timeUsec = sourceUsec;
+        sample.dx = static_cast<float>(deltaX);
+        sample.dxUnaccelerated = static_cast<float>(rawDeltaX);
+        sample.threshold = static_cast<float>(threshold);
+        sample.heldKeycode = heldAfter;
+        sample.motionResult = static_cast<uint8_t>(result);
+        m_telemetry.push(sample);
+    }
+    // Nothing held means nothing to release: leave no timer behind, so an idle controller
+    // sleeps in epoll_wait() until the next input event.
+    if (heldAfter == 0 && heldBefore != 0) {
+        disarmIdleTimer();
+    }
+    if (heldAfter != heldBefore && result != MotionResult::Inactive) {
+        publishStatus(heldAfter != 0 ? ControllerStatus::Phase::Holding : ControllerStatus::Phase::Active);
     }
 }
 
-void InputController::handleKeyboardKey(libinput_event_keyboard *keyboardEvent)
+void InputController::flushCoalescedMotion()
 {
-    if (!keyboardEvent) {
-        return;
+    for (const uint8_t slot : std::as_const(m_coalescedSlots)) {
+        PointerState &state = m_pointerStates[slot];
+        state.pending = false;
+        const double deltaX = state.pendingDx;
+        const double rawDeltaX = state.pendingDxUnaccelerated;
+        const double deltaY = state.pendingDy;
+        const double rawDeltaY = state.pendingDyUnaccelerated;
+
+        // Switching away from the held key needs the net motion to clear the hysteresis;
+        // the target comes from the same table handleMotion() will use.
+        const double threshold = state.motionThreshold;
+        const double hysteresis = m_coalesceHysteresis;
+        const bool passes = std::visit(
+            [=](auto &engine) {
+                engine.threshold().value = threshold;
+                return engine.passesHysteresis(deltaX, rawDeltaX, deltaY, rawDeltaY, hysteresis);
+            },
+            m_engine);
+        if (!passes) {
+            continue;
+        }
+
+        m_traceRecord = m_trace.begin();
+        if (m_traceRecord) {
+            m_traceRecord->timeUsec = state.pendingSinceUsec;
+            m_traceRecord->type = TraceEventType::CoalescedMotion;
+            m_traceRecord->deviceId = state.deviceId;
+            m_traceRecord->dx = static_cast<float>(deltaX);
+            m_traceRecord->dxUnaccelerated = static_cast<float>(rawDeltaX);
+        }
+
+        m_frameSourceUsec = state.pendingSinceUsec;
+        m_frameDeviceId = state.deviceId;
+        applyMotion(slot, deltaX, rawDeltaX, deltaY, rawDeltaY);
+        m_frameSourceUsec = 0;
+        m_frameDeviceId = 0;
+
+        if (m_traceRecord) {
+            m_traceRecord = nullptr;
+            m_trace.commit();
+        }
     }
+    m_coalescedSlots.clear();
+}
 
-    libinput_event *baseEvent = libinput_event_keyboard_get_base_event(keyboardEvent);
-    libinput_device *device = baseEvent ? libinput_event_get_device(baseEvent) : nullptr;
-    if (!isKeyboardDeviceAllowed(device)) {
+void InputController::handleKeyboardKey(const InputEvent &event)
+{
+    const InputDevice *device = event.device;
+    if (!device || !device->keyboardAllowed) {
+        m_counters.increment(RuntimeCounters::FilteredKeyboardEvents);
         return;
     }
 
     updateKeyboardDevice(device);
 
-    const uint32_t key = libinput_event_keyboard_get_key(keyboardEvent);
-    if (key != m_activationKeycode.load(std::memory_order_relaxed)) {
+    m_frameSourceUsec = event.timeUsec;
+    m_frameDeviceId = device->id;
+    const bool changed = std::visit([&event](auto &engine) { return engine.handleKey(event.key, event.pressed); }, m_engine);
+    if (!changed) {
         return;
     }
 
-    const libinput_key_state state = libinput_event_keyboard_get_key_state(keyboardEvent);
-    const bool pressed = (state == LIBINPUT_KEY_STATE_PRESSED);
-    if (pressed == m_activationPressed) {
-        return;
-    }
-
-    m_activationPressed = pressed;
-    if (!pressed) {
-        releaseActiveKey();
-        emit statusChanged(QStringLiteral("Призупинено."));
+    if (directionState().activationPressed) {
+        publishStatus(ControllerStatus::Phase::Active);
     } else {
-        emit statusChanged(QStringLiteral("Активно."));
+        disarmIdleTimer();
+        publishStatus(ControllerStatus::Phase::Paused);
     }
 }
 
-void InputController::handleDeviceAdded(libinput_event *event)
+void InputController::beginCalibration(int durationMs)
 {
-    if (!event) {
+    m_calibrators.clear();
+    m_calibrating = true;
+
+    // Ends on the clock, not on the next motion event: a mouse that never moves still gets
+    // calibrationFinished (with no results), so the GUI always gets its button back.
+    itimerspec spec{};
+    spec.it_value.tv_sec = static_cast<time_t>(durationMs / 1000);
+    spec.it_value.tv_nsec = static_cast<long>(durationMs % 1000) * 1000000;
+    if (m_calibrationTimerFd < 0 || timerfd_settime(m_calibrationTimerFd, 0, &spec, nullptr) < 0) {
+        finishCalibration();
         return;
     }
+    emit statusChanged(QStringLiteral("Калібрування: рухайте мишею протягом %1 с...").arg(durationMs / 1000));
+}
 
-    libinput_device *device = libinput_event_get_device(event);
+void InputController::recordCalibrationSample(const InputDevice *device, uint64_t timeUsec, double deltaX, double rawDeltaX)
+{
+    m_calibrators[device].addSample(timeUsec, deltaX, rawDeltaX);
+}
+
+void InputController::finishCalibration()
+{
+    m_calibrating = false;
+
+    QVector<DeviceCalibration> calibrations;
+    for (const auto &entry : m_calibrators) {
+        const InputDevice *device = entry.first;
+        DeviceCalibration calibration;
+        if (!entry.second.compute(calibration.result)) {
+            continue;
+        }
+
+        calibration.vendor = device->vendor;
+        calibration.product = device->product;
+        calibration.name = device->name;
+        m_calibrations.insert(calibrationKey(device->vendor, device->product), calibration.result);
+        calibrations.append(calibration);
+    }
+    m_calibrators.clear();
+
+    reclassifyDevices();
+    emit calibrationFinished(calibrations);
+}
+
+void InputController::handleDeviceAdded(const InputEvent &event)
+{
+    InputDevice *device = event.device;
     if (!device) {
         return;
     }
 
-    if (isPointerDeviceAllowed(device)) {
+    if (!m_devices.contains(device)) {
+        device->id = m_nextDeviceId++;
+        if (m_nextDeviceId == 0) {
+            m_nextDeviceId = 1;
+        }
+        device->stateSlot = device->pointer ? m_pointerStates.acquire() : PointerStateTable::kSharedSlot;
+        m_devices.append(device);
+    }
+    classifyDevice(device);
+    markDevicesChanged();
+
+    if (device->pointerAllowed) {
         updatePointerDevice(device);
     }
 
-    if (isKeyboardDeviceAllowed(device)) {
+    if (device->keyboardAllowed) {
         updateKeyboardDevice(device);
     }
 }
 
-void InputController::handleDeviceRemoved(libinput_event *event)
+void InputController::handleDeviceRemoved(const InputEvent &event)
 {
-    if (!event) {
-        return;
-    }
-
-    libinput_device *device = libinput_event_get_device(event);
+    const InputDevice *device = event.device;
     if (!device) {
         return;
     }
 
-    const QString descriptor = describeDevice(device);
-    bool changed = false;
-    {
-        QMutexLocker locker(&m_deviceMutex);
-        if (m_pointerDetected && (!descriptor.isEmpty() && m_pointerDeviceName == descriptor)) {
-            m_pointerDetected = false;
-            m_pointerDeviceName.clear();
-            changed = true;
-        }
-        if (m_keyboardDetected && (!descriptor.isEmpty() && m_keyboardDeviceName == descriptor)) {
-            m_keyboardDetected = false;
-            m_keyboardDeviceName.clear();
-            changed = true;
+    if (m_devices.removeAll(event.device) > 0) {
+        if (device->pointer) {
+            if (m_motionOwner == device->stateSlot) {
+                m_motionOwner = kNoMotionOwner;
+            }
+            m_pointerStates.release(device->stateSlot);
         }
+        markDevicesChanged();
     }
+    m_calibrators.erase(device);
 
-    if (changed) {
-        refreshDeviceSignal();
+    if (m_pointerDevice == device) {
+        m_pointerDevice = nullptr;
+    }
+    if (m_keyboardDevice == device) {
+        m_keyboardDevice = nullptr;
     }
 }
 
-void InputController::pressKey(uint16_t keycode)
+void InputController::applyTransition(uint16_t releasedKeycode, uint16_t pressedKeycode)
 {
-    if (m_uinputFd < 0 || keycode == 0) {
-        return;
+    MDB_PROBE4(key_transition, m_frameSourceUsec, m_frameDeviceId, releasedKeycode, pressedKeycode);
+    if (m_traceRecord) {
+        m_traceRecord->releasedKeycode = releasedKeycode;
+        m_traceRecord->pressedKeycode = pressedKeycode;
     }
 
-    if (m_currentlyPressedKeycode == keycode) {
-        return;
+    m_frame.clear();
+    if (releasedKeycode != 0) {
+        m_frame.addKey(releasedKeycode, 0);
     }
+    if (pressedKeycode != 0) {
+        m_frame.addKey(pressedKeycode, 1);
+    }
+    submitFrame();
 
-    releaseActiveKey();
-    sendKeyEvent(keycode, 1);
-    m_currentlyPressedKeycode = keycode;
-
-    const QString keyName = (keycode == m_keycodeA) ? QStringLiteral("A") : QStringLiteral("D");
-    emit statusChanged(QStringLiteral("Утримується клавіша %1.").arg(keyName));
+    if (pressedKeycode != 0) {
+        ++m_status.transitions;
+        if (!m_idleTimerArmed) {
+            armIdleTimer();
+        }
+    }
 }
 
-void InputController::releaseKey(uint16_t keycode)
+void InputController::publishStatus(ControllerStatus::Phase phase)
 {
-    if (m_uinputFd < 0 || keycode == 0) {
-        return;
-    }
-
-    sendKeyEvent(keycode, 0);
+    ++m_status.version;
+    m_status.phase = phase;
+    m_status.activationHeld = directionState().activationPressed;
+    m_status.activeKeycode = directionState().heldKeycode;
+    m_publishedStatus.store(m_status);
 }
 
-void InputController::sendKeyEvent(uint16_t keycode, int value)
+void InputController::submitFrame()
 {
     if (m_uinputFd < 0) {
+        m_frame.clear();
         return;
     }
 
-    input_event event{};
-    gettimeofday(&event.time, nullptr);
-    event.type = EV_KEY;
-    event.code = keycode;
-    event.value = value;
-    if (write(m_uinputFd, &event, sizeof(event)) < 0) {
+    const uint64_t sourceUsec = m_frameSourceUsec;
+    m_frameSourceUsec = 0;
+
+    MDB_PROBE3(uinput_submit, sourceUsec, m_frameDeviceId, m_frame.keyCount());
+    const bool written = m_frame.submit(m_uinputFd);
+    MDB_PROBE3(uinput_submitted, sourceUsec, m_frameDeviceId, written ? 1 : 0);
+    if (!written) {
+        m_counters.increment(RuntimeCounters::UinputWriteErrors);
         emit errorOccurred(QStringLiteral("Помилка запису у uinput: %1").arg(QString::fromLocal8Bit(strerror(errno))));
         return;
     }
 
-    input_event sync{};
-    gettimeofday(&sync.time, nullptr);
-    sync.type = EV_SYN;
-    sync.code = SYN_REPORT;
-    sync.value = 0;
-    if (write(m_uinputFd, &sync, sizeof(sync)) < 0) {
-        emit errorOccurred(QStringLiteral("Помилка синхронізації uinput: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+    m_counters.increment(RuntimeCounters::UinputWrites);
+
+    const uint64_t sourceNs = sourceUsec * 1000;
+    if (sourceUsec != 0 && m_frame.lastSubmitNs() >= sourceNs) {
+        m_latency.record(m_frame.lastSubmitNs() - sourceNs);
     }
 }
 
-void InputController::releaseActiveKey()
+bool InputController::isPointerDeviceAllowed(const InputDevice *device) const
 {
-    if (m_currentlyPressedKeycode == 0) {
-        return;
+    if (!device || !device->pointer) {
+        return false;
     }
-
-    releaseKey(m_currentlyPressedKeycode);
-    m_currentlyPressedKeycode = 0;
+    return m_pointerFilter.allows(device->name, device->vendor, device->product);
 }
 
-bool InputController::shouldApplyMotion()
+bool InputController::isKeyboardDeviceAllowed(const InputDevice *device) const
 {
-    if (!m_randomizerEnabled.load(std::memory_order_relaxed)) {
-        return true;
+    if (!device || !device->keyboard) {
+        return false;
     }
+    return m_keyboardFilter.allows(device->name, device->vendor, device->product);
+}
 
-    int minimum = m_randomizerMinimum.load(std::memory_order_relaxed);
-    int maximum = m_randomizerMaximum.load(std::memory_order_relaxed);
-    if (maximum < minimum) {
-        std::swap(minimum, maximum);
+QString InputController::describeDevice(const InputDevice *device) const
+{
+    if (!device) {
+        return QString();
     }
 
-    minimum = std::clamp(minimum, 0, 100);
-    maximum = std::clamp(maximum, 0, 100);
+    const QString name = device->name.trimmed();
+    const quint32 vendor = device->vendor;
+    const quint32 product = device->product;
+    const QString vendorText = QStringLiteral("%1").arg(vendor, 4, 16, QLatin1Char('0')).toUpper();
+    const QString productText = QStringLiteral("%1").arg(product, 4, 16, QLatin1Char('0')).toUpper();
 
-    if (maximum == 0) {
-        return false;
+    if (name.isEmpty()) {
+        return QStringLiteral("VID:%1 PID:%2").arg(vendorText, productText);
     }
 
-    std::uniform_int_distribution<int> percentDistribution(minimum, maximum);
-    const int percent = percentDistribution(m_randomEngine);
-    const double probability = static_cast<double>(percent) / 100.0;
-
-    return m_unitDistribution(m_randomEngine) <= probability;
+    return QStringLiteral("%1 (VID:%2 PID:%3)").arg(name, vendorText, productText);
 }
 
-bool InputController::isPointerDeviceAllowed(libinput_device *device)
+void InputController::classifyDevice(InputDevice *device)
 {
-    if (!device) {
-        return false;
-    }
+    device->descriptor = describeDevice(device);
+    device->pointerAllowed = isPointerDeviceAllowed(device);
+    device->keyboardAllowed = isKeyboardDeviceAllowed(device);
 
-    if (!libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_POINTER) &&
-        !libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_GESTURE)) {
-        return false;
+    if (!device->pointer) {
+        return;
     }
-
-    const QString deviceName = QString::fromLocal8Bit(libinput_device_get_name(device)).toLower();
-    QStringList allowed;
-    QStringList blocked;
-    {
-        QMutexLocker locker(&m_deviceMutex);
-        allowed = m_pointerAllowedBrands;
-        blocked = m_pointerBlockedBrands;
+    const auto calibration = m_calibrations.constFind(calibrationKey(device->vendor, device->product));
+    PointerState &state = m_pointerStates[device->stateSlot];
+    if (calibration != m_calibrations.constEnd()) {
+        state.motionThreshold = calibration->motionThreshold;
+        state.idleReleaseMs = calibration->idleReleaseMs;
+    } else {
+        state.motionThreshold = FixedThreshold::kThreshold;
+        state.idleReleaseMs = MotionCalibrator::kBaseIdleReleaseMs;
     }
+}
 
-    for (const QString &entry : blocked) {
-        if (!entry.isEmpty() && deviceName.contains(entry)) {
-            return false;
-        }
+void InputController::reclassifyDevices()
+{
+    for (InputDevice *device : m_devices) {
+        classifyDevice(device);
     }
+    markDevicesChanged();
 
-    if (allowed.isEmpty()) {
-        return true;
+    if (m_pointerDevice && !m_pointerDevice->pointerAllowed) {
+        m_pointerDevice = nullptr;
+    }
+    if (m_keyboardDevice && !m_keyboardDevice->keyboardAllowed) {
+        m_keyboardDevice = nullptr;
     }
+}
 
-    for (const QString &entry : allowed) {
-        if (!entry.isEmpty() && deviceName.contains(entry)) {
-            return true;
-        }
+void InputController::updatePointerDevice(const InputDevice *device)
+{
+    if (m_pointerDevice == device) {
+        return;
     }
 
-    return false;
+    m_pointerDevice = device;
+    markDevicesChanged();
 }
 
-bool InputController::isKeyboardDeviceAllowed(libinput_device *device)
+void InputController::updateKeyboardDevice(const InputDevice *device)
 {
-    if (!device) {
-        return false;
+    if (m_keyboardDevice == device) {
+        return;
     }
 
-    if (!libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_KEYBOARD)) {
-        return false;
-    }
+    m_keyboardDevice = device;
+    markDevicesChanged();
+}
 
-    const QString deviceName = QString::fromLocal8Bit(libinput_device_get_name(device)).toLower();
-    QStringList allowed;
-    QStringList blocked;
-    {
-        QMutexLocker locker(&m_deviceMutex);
-        allowed = m_keyboardAllowedBrands;
-        blocked = m_keyboardBlockedBrands;
-    }
+namespace
+{
+CachedDevice cacheEntry(const InputDevice *device)
+{
+    CachedDevice entry;
+    if (device && !device->devnode.isEmpty()) {
+        entry.node = device->devnode;
+        entry.name = device->name;
+        entry.vendor = device->vendor;
+        entry.product = device->product;
+    }
+    return entry;
+}
+} // namespace
 
-    for (const QString &entry : blocked) {
-        if (!entry.isEmpty() && deviceName.contains(entry)) {
-            return false;
-        }
+void InputController::publishDevices()
+{
+    // While the activation key is held, a mouse and a touchpad taking turns would otherwise
+    // rebuild the inventory and rewrite the device cache on every switch; the changes go out
+    // with the wakeup that releases the key.
+    if (!m_devicesChanged || directionState().activationPressed) {
+        return;
     }
+    m_devicesChanged = false;
+
+    DeviceInventory inventory;
+    inventory.reserve(m_devices.size());
+    for (const InputDevice *device : std::as_const(m_devices)) {
+        DeviceInventoryEntry entry;
+        entry.id = device->id;
+        entry.sysname = device->sysname;
+        entry.devnode = device->devnode;
+        entry.descriptor = device->descriptor;
+        entry.pointer = device->pointer;
+        entry.keyboard = device->keyboard;
+        entry.pointerAllowed = device->pointerAllowed;
+        entry.keyboardAllowed = device->keyboardAllowed;
+        entry.activePointer = (device == m_pointerDevice);
+        entry.activeKeyboard = (device == m_keyboardDevice);
+        inventory.append(entry);
+    }
+    emit inventoryChanged(inventory);
+
+    const QString pointer = m_pointerDevice ? m_pointerDevice->descriptor : QString();
+    const QString keyboard = m_keyboardDevice ? m_keyboardDevice->descriptor : QString();
+    if (pointer == m_publishedPointer && keyboard == m_publishedKeyboard) {
+        return;
+    }
+    m_publishedPointer = pointer;
+    m_publishedKeyboard = keyboard;
+    emit devicesDetected(pointer, keyboard);
 
-    if (allowed.isEmpty()) {
-        return true;
+    const CachedDevice pointerEntry = cacheEntry(m_pointerDevice);
+    const CachedDevice keyboardEntry = cacheEntry(m_keyboardDevice);
+    if (!pointerEntry.node.isEmpty() || !keyboardEntry.node.isEmpty()) {
+        emit cachedDevicesChanged(pointerEntry, keyboardEntry);
     }
+}
 
-    for (const QString &entry : allowed) {
-        if (!entry.isEmpty() && deviceName.contains(entry)) {
-            return true;
+bool InputController::requestDeviceAccess(const QString &devicePath)
+{
+    // Never waits for the answer: the backend treats the node as unavailable for now and
+    // applyAccessDecision() has it reopened once access is granted.
+    {
+        QMutexLocker locker(&m_accessMutex);
+        if (m_accessRefused.contains(devicePath) || m_accessGranted.contains(devicePath)) {
+            return false;
         }
+        if (m_accessPending) {
+            if (!m_accessBatch.contains(devicePath) && !m_accessLatePaths.contains(devicePath)) {
+                m_accessLatePaths.append(devicePath);
+            }
+            return false;
+        }
+        m_accessPending = true;
+        m_accessBatch = QStringList{devicePath};
     }
 
+    emitAccessRequest({devicePath});
     return false;
 }
 
-QString InputController::describeDevice(libinput_device *device) const
+void InputController::requestAccessBatch(const QStringList &devicePaths)
 {
-    if (!device) {
-        return QString();
+    QStringList paths = devicePaths;
+    if (m_virtualDeviceEnabled && m_uinputFd < 0 && !paths.contains(QString::fromLatin1(kUinputPath))) {
+        paths.prepend(QString::fromLatin1(kUinputPath));
     }
 
-    const QString name = QString::fromLocal8Bit(libinput_device_get_name(device)).trimmed();
-    const quint32 vendor = libinput_device_get_id_vendor(device);
-    const quint32 product = libinput_device_get_id_product(device);
-    const QString vendorText = QStringLiteral("%1").arg(vendor, 4, 16, QLatin1Char('0')).toUpper();
-    const QString productText = QStringLiteral("%1").arg(product, 4, 16, QLatin1Char('0')).toUpper();
-
-    if (name.isEmpty()) {
-        return QStringLiteral("VID:%1 PID:%2").arg(vendorText, productText);
+    const QStringList inaccessible = inaccessibleNodes(paths);
+    if (inaccessible.isEmpty()) {
+        return;
     }
 
-    return QStringLiteral("%1 (VID:%2 PID:%3)").arg(name, vendorText, productText);
-}
-
-void InputController::updatePointerDevice(libinput_device *device)
-{
-    const QString descriptor = describeDevice(device);
-    bool changed = false;
     {
-        QMutexLocker locker(&m_deviceMutex);
-        if (!descriptor.isEmpty() && m_pointerDeviceName != descriptor) {
-            m_pointerDeviceName = descriptor;
-            m_pointerDetected = true;
-            changed = true;
-        } else if (!m_pointerDetected && descriptor.isEmpty()) {
-            m_pointerDetected = true;
-            changed = true;
+        QMutexLocker locker(&m_accessMutex);
+        if (m_accessPending) {
+            for (const QString &path : inaccessible) {
+                if (!m_accessBatch.contains(path) && !m_accessLatePaths.contains(path)) {
+                    m_accessLatePaths.append(path);
+                }
+            }
+            return;
         }
+        m_accessPending = true;
+        m_accessBatch = inaccessible;
     }
-
-    if (changed) {
-        refreshDeviceSignal();
-    }
+    emitAccessRequest(inaccessible);
 }
 
-void InputController::updateKeyboardDevice(libinput_device *device)
+bool InputController::isAccessPending(const QString &devicePath)
 {
-    const QString descriptor = describeDevice(device);
-    bool changed = false;
-    {
-        QMutexLocker locker(&m_deviceMutex);
-        if (!descriptor.isEmpty() && m_keyboardDeviceName != descriptor) {
-            m_keyboardDeviceName = descriptor;
-            m_keyboardDetected = true;
-            changed = true;
-        } else if (!m_keyboardDetected && descriptor.isEmpty()) {
-            m_keyboardDetected = true;
-            changed = true;
-        }
-    }
-
-    if (changed) {
-        refreshDeviceSignal();
-    }
+    QMutexLocker locker(&m_accessMutex);
+    return m_accessPending && m_accessBatch.contains(devicePath);
 }
 
-void InputController::refreshDeviceSignal()
+bool InputController::isAnyAccessPending()
 {
-    QString pointer;
-    QString keyboard;
-    {
-        QMutexLocker locker(&m_deviceMutex);
-        pointer = m_pointerDetected ? m_pointerDeviceName : QString();
-        keyboard = m_keyboardDetected ? m_keyboardDeviceName : QString();
-    }
-
-    emit devicesDetected(pointer, keyboard);
+    QMutexLocker locker(&m_accessMutex);
+    return m_accessPending;
 }
 
-bool InputController::requestDeviceAccess(const QString &devicePath)
+bool InputController::applyAccessDecision(bool granted)
 {
+    const QString uinputPath = QString::fromLatin1(kUinputPath);
+    QStringList paths;
+    QStringList latePaths;
+    bool uinputRefused = false;
     {
         QMutexLocker locker(&m_accessMutex);
-        while (m_accessDecisionPending && !isInterruptionRequested()) {
-            m_accessWait.wait(&m_accessMutex);
-        }
-        if (isInterruptionRequested()) {
+        paths = std::exchange(m_accessGranted, QStringList());
+        latePaths = std::exchange(m_accessLatePaths, QStringList());
+        uinputRefused = m_accessRefused.contains(uinputPath);
+    }
+
+    // Without /dev/uinput every frame would be dropped while the status still says Ready.
+    if (m_virtualDeviceEnabled && m_uinputFd < 0 && uinputRefused) {
+        emit errorOccurred(QStringLiteral("Не вдалося відкрити /dev/uinput: доступ не надано."));
+        return false;
+    }
+    if (!m_backend) {
+        return true;
+    }
+
+    if (granted && paths.removeAll(uinputPath) > 0 && m_uinputFd < 0 && !setupUinput()) {
+        return false;
+    }
+
+    // Nodes that showed up while the prompt was open were not part of it and get their own
+    // prompt; they are reopened once that one is granted.
+    requestAccessBatch(latePaths);
+    if (!granted) {
+        // Same as a refused uinput: the status would say Ready while no event ever arrives.
+        if (!m_backend->hasOpenDevices() && !isAnyAccessPending()) {
+            emit errorOccurred(QStringLiteral("Не вдалося відкрити жодного пристрою введення: доступ не надано."));
             return false;
         }
-        m_accessDecisionPending = true;
-        m_accessGranted = false;
-        m_pendingAccessPath = devicePath;
+        return true;
     }
+    m_backend->reopenDevices(paths);
 
-    emitAccessRequest(devicePath);
-
-    QMutexLocker locker(&m_accessMutex);
-    while (m_accessDecisionPending && !isInterruptionRequested()) {
-        m_accessWait.wait(&m_accessMutex);
+    QString errorText;
+    const bool dispatched = m_backend->dispatch(errorText);
+    flushCoalescedMotion();
+    if (!dispatched) {
+        emit errorOccurred(errorText);
+        return false;
     }
-    return m_accessGranted;
+    return true;
 }
 
-void InputController::emitAccessRequest(const QString &path)
+void InputController::emitAccessRequest(const QStringList &paths)
 {
-    emit accessConfirmationRequested(path);
+    emit accessConfirmationRequested(paths);
 }
 
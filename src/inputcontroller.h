@@ -1,38 +1,119 @@
 #pragma once
 
+#include "brandmatcher.h"
+#include "controllerstatus.h"
+#include "deviceinventory.h"
+#include "directionengine.h"
+#include "inputbackend.h"
+#include "latencyhistogram.h"
+#include "motioncalibrator.h"
+#include "pointerstate.h"
+#include "realtimetuning.h"
+#include "runtimecounters.h"
+#include "seqlock.h"
+#include "spscqueue.h"
+#include "telemetryring.h"
+#include "tracerecorder.h"
+#include "uinputframe.h"
+
+#include <QHash>
 #include <QMutex>
 #include <QObject>
 #include <QThread>
-#include <QWaitCondition>
 #include <QStringList>
 #include <QString>
+#include <QVector>
 
 #include <atomic>
 #include <chrono>
-#include <random>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <variant>
 
 #include <linux/input-event-codes.h>
 
-struct libinput;
-struct udev;
-struct libinput_event;
-struct libinput_event_pointer;
-struct libinput_event_keyboard;
+// Everything that can change while the controller runs; applyLiveConfig() swaps all of it
+// in at once between two input events, without reopening the backend or uinput.
+struct LiveConfig {
+    quint32 activationKeycode{KEY_LEFTSHIFT};
+    bool randomizerEnabled{false};
+    int randomizerMinimum{100};
+    int randomizerMaximum{100};
+    QStringList pointerAllowedBrands;
+    QStringList pointerBlockedBrands;
+    QStringList keyboardAllowedBrands;
+    QStringList keyboardBlockedBrands;
+    QVector<DeviceCalibration> calibrations;
+    // Every key in it must have been passed to setMappedKeys() before start().
+    KeyMap keyMap;
+};
 
-class InputController : public QThread
+// The input loop runs on this QThread. Setters, stopController() and
+// deliverAccessConfirmation() post commands to it through a single-producer queue, so they
+// must all be called from the thread that created the controller (the GUI or daemon main
+// thread); debug builds assert this.
+class InputController : public QThread, private InputBackendHost
 {
     Q_OBJECT
 public:
+    // About a second of motion at 8 kHz.
+    using MotionTelemetry = TelemetryRing<8192>;
+
     explicit InputController(QObject *parent = nullptr);
     ~InputController() override;
 
     void stopController();
 
+    // Takes effect on the next start(); the evdev list may be empty to scan /dev/input.
+    void setInputBackend(InputBackend::Kind kind, const QStringList &evdevDevicePaths);
+    // Takes effect on the next start() and overrides setInputBackend(); used by mdb_bench.
+    using BackendFactory = std::function<std::unique_ptr<InputBackend>(InputBackendHost &host)>;
+    void setBackendFactory(BackendFactory factory);
+    // Takes effect on the next start(). When disabled, frames go to /dev/null instead of a
+    // uinput device, so the full output path runs without touching the session.
+    void setVirtualDeviceEnabled(bool enabled);
+    // Takes effect on the next start(); an empty path disables recording.
+    void setTraceRecording(const QString &path, quint64 capacity);
+    // Takes effect on the next start(); applied to the controller thread once set up.
+    void setRealtimeOptions(const RealtimeOptions &options);
+    // Takes effect on the next start(). When enabled, motion is summed per device over each
+    // backend dispatch and applied once at its end; reversing a held key then needs a net
+    // |dx| of at least hysteresis.
+    void setMotionCoalescing(bool enabled, double hysteresis);
+    // Takes effect on the next start(); only used by the libinput backend.
+    void setCachedDevices(const QVector<CachedDevice> &devices);
+    // Takes effect on the next start(); later calibrations update the table themselves.
+    void setDeviceCalibrations(const QVector<DeviceCalibration> &calibrations);
+    // Takes effect on the next start(): every key any mapping profile can press, so the uinput
+    // device is set up once and switching profiles needs no restart.
+    void setMappedKeys(const QVector<uint16_t> &keycodes);
+
+    // Filters are compiled on the calling thread; the controller only swaps them in.
+    void applyLiveConfig(const LiveConfig &config);
+
+    // Safe to call from any thread; never blocks the controller.
+    ControllerStatus statusSnapshot() const;
+    // Event timestamp to uinput write, for transitions caused by an input event.
+    const LatencyHistogram &latencyHistogram() const { return m_latency; }
+    const RuntimeCounters &runtimeCounters() const { return m_counters; }
+    // Safe to call from any thread. While disabled, applyMotion() pays one relaxed load.
+    void setTelemetryEnabled(bool enabled) { m_telemetryEnabled.store(enabled, std::memory_order_relaxed); }
+    const MotionTelemetry &motionTelemetry() const { return m_telemetry; }
+
 signals:
     void statusChanged(const QString &statusText);
     void errorOccurred(const QString &errorText);
+    // Both are emitted at most once per backend dispatch; devicesDetected() only when the
+    // chosen pointer or keyboard changed, inventoryChanged() when any device did.
     void devicesDetected(const QString &pointerName, const QString &keyboardName);
-    void accessConfirmationRequested(const QString &devicePath);
+    void inventoryChanged(const DeviceInventory &inventory);
+    // Either may be empty (no node, or no device chosen for that role); keep the old entry then.
+    void cachedDevicesChanged(const CachedDevice &pointer, const CachedDevice &keyboard);
+    // Every node in the list is covered by one answer to deliverAccessConfirmation().
+    void accessConfirmationRequested(const QStringList &devicePaths);
+    void calibrationFinished(const QVector<DeviceCalibration> &calibrations);
+    void realtimeStatusReported(const QString &scheduling, const QString &affinity, const QString &memoryLock, const QString &timerSlack);
 
 public slots:
     void setActivationKeycode(quint32 keycode);
@@ -40,79 +121,194 @@ public slots:
     void setRandomizerRange(int minimumPercent, int maximumPercent);
     void setPointerBrandFilters(const QStringList &allowed, const QStringList &blocked);
     void setKeyboardBrandFilters(const QStringList &allowed, const QStringList &blocked);
+    void resetLatencyStatistics();
+    void startCalibration(int durationMs);
     void deliverAccessConfirmation(bool granted);
 
 protected:
     void run() override;
 
 private:
-    static int openRestricted(const char *path, int flags, void *userData);
-    static void closeRestricted(int fd, void *userData);
-
     bool setupUinput();
     void teardownUinput();
-    bool setupLibinput();
-    void teardownLibinput();
-
-    void applyPendingActivation();
-    void processEvent(libinput_event *event);
-    void handlePointerMotion(libinput_event_pointer *pointerEvent);
-    void handleKeyboardKey(libinput_event_keyboard *keyboardEvent);
-    void handleDeviceAdded(libinput_event *event);
-    void handleDeviceRemoved(libinput_event *event);
-
-    void pressKey(uint16_t keycode);
-    void releaseKey(uint16_t keycode);
-    void sendKeyEvent(uint16_t keycode, int value);
-    void releaseActiveKey();
-    bool shouldApplyMotion();
-    bool isPointerDeviceAllowed(libinput_device *device);
-    bool isKeyboardDeviceAllowed(libinput_device *device);
-    QString describeDevice(libinput_device *device) const;
-    void updatePointerDevice(libinput_device *device);
-    void updateKeyboardDevice(libinput_device *device);
-    void refreshDeviceSignal();
-    bool requestDeviceAccess(const QString &devicePath);
-    void emitAccessRequest(const QString &path);
+    bool setupBackend();
+    void teardownBackend();
+    void setupTraceRecorder();
+    bool setupEventLoop();
+    void teardownEventLoop();
+    void wakeEventLoop();
+    void armIdleTimer();
+    void disarmIdleTimer();
+    void handleIdleTimer();
+
+    // Compiled by the caller so the controller thread only swaps it in.
+    struct BrandFilters {
+        BrandMatcher matcher;
+    };
+
+    struct LiveSnapshot {
+        BrandMatcher pointerFilter;
+        BrandMatcher keyboardFilter;
+        QHash<quint64, CalibrationResult> calibrations;
+        KeyMap keyMap;
+    };
+
+    struct ControllerCommand {
+        enum class Type : uint8_t {
+            ActivationKey,
+            RandomizerEnabled,
+            RandomizerRange,
+            PointerFilters,
+            KeyboardFilters,
+            ResetLatency,
+            StartCalibration,
+            AccessDecision,
+            LiveConfig,
+            Shutdown
+        };
+
+        Type type{Type::Shutdown};
+        uint16_t keycode{0};
+        bool enabled{false};
+        int minimum{0};
+        int maximum{0};
+        int durationMs{0};
+        BrandFilters *filters{nullptr};
+        LiveSnapshot *snapshot{nullptr};
+    };
+
+    struct UinputSink {
+        InputController *controller;
+
+        void applyTransition(uint16_t releasedKeycode, uint16_t pressedKeycode)
+        {
+            controller->applyTransition(releasedKeycode, pressedKeycode);
+        }
+    };
+
+    // The common randomizer-off configuration gets its own instantiation; the variant is
+    // only re-seated when the randomizer is toggled, carrying the DirectionState across.
+    using PlainEngine = DirectionEngine<DeviceThreshold, NoRandomizer, UinputSink>;
+    using RandomizedEngine = DirectionEngine<DeviceThreshold, PercentRandomizer, UinputSink>;
+
+    void postCommand(const ControllerCommand &command);
+    bool drainCommands();
+    void applyActivationKeycode(uint16_t keycode);
+    void applyRandomizerEnabled(bool enabled);
+    void applyRandomizerRange(int minimum, int maximum);
+    void applyKeyMap(const KeyMap &keyMap);
+    const KeyMap &keyMap() const;
+    const DirectionState &directionState() const;
+    void handleInputEvent(const InputEvent &event) override;
+    void processEvent(const InputEvent &event);
+    void handlePointerMotion(const InputEvent &event);
+    void applyMotion(uint8_t slot, double deltaX, double rawDeltaX, double deltaY, double rawDeltaY);
+    void flushCoalescedMotion();
+    void handleKeyboardKey(const InputEvent &event);
+    void beginCalibration(int durationMs);
+    void recordCalibrationSample(const InputDevice *device, uint64_t timeUsec, double deltaX, double rawDeltaX);
+    void finishCalibration();
+    void handleDeviceAdded(const InputEvent &event);
+    void handleDeviceRemoved(const InputEvent &event);
+
+    void publishStatus(ControllerStatus::Phase phase);
+    void applyTransition(uint16_t releasedKeycode, uint16_t pressedKeycode);
+    void submitFrame();
+    bool isPointerDeviceAllowed(const InputDevice *device) const;
+    bool isKeyboardDeviceAllowed(const InputDevice *device) const;
+    QString describeDevice(const InputDevice *device) const;
+    void classifyDevice(InputDevice *device);
+    void reclassifyDevices();
+    void updatePointerDevice(const InputDevice *device);
+    void updateKeyboardDevice(const InputDevice *device);
+    void markDevicesChanged() { m_devicesChanged = true; }
+    void publishDevices();
+    bool requestDeviceAccess(const QString &devicePath) override;
+    void requestAccessBatch(const QStringList &devicePaths);
+    bool isAccessPending(const QString &devicePath);
+    bool isAnyAccessPending();
+    // false when the controller cannot go on and the loop has to stop.
+    bool applyAccessDecision(bool granted);
+    void emitAccessRequest(const QStringList &paths);
 
     int m_uinputFd{-1};
-    libinput *m_libinput{nullptr};
-    udev *m_udev{nullptr};
+    int m_epollFd{-1};
+    int m_idleTimerFd{-1};
+    int m_calibrationTimerFd{-1};
+    int m_wakeFd{-1};
+    bool m_idleTimerArmed{false};
+
+    InputBackend::Kind m_preferredBackend{InputBackend::Kind::Libinput};
+    QStringList m_evdevDevicePaths;
+    QVector<CachedDevice> m_cachedDevices;
+    BackendFactory m_backendFactory;
+    std::unique_ptr<InputBackend> m_backend;
+    bool m_virtualDeviceEnabled{true};
+    QVector<uint16_t> m_uinputKeys{KEY_A, KEY_D};
+
+    QString m_tracePath;
+    quint64 m_traceCapacity{TraceRecorder::kDefaultCapacity};
+    TraceRecorder m_trace;
+    TraceRecord *m_traceRecord{nullptr};
+    uint16_t m_nextDeviceId{1};
 
-    std::atomic<bool> m_randomizerEnabled{false};
-    std::atomic<int> m_randomizerMinimum{70};
-    std::atomic<int> m_randomizerMaximum{90};
+    RealtimeOptions m_realtimeOptions;
 
-    QMutex m_activationMutex;
-    uint16_t m_pendingActivationKeycode{KEY_LEFTSHIFT};
-    bool m_activationDirty{true};
+    bool m_coalesceMotion{false};
+    double m_coalesceHysteresis{1.0};
+    QVector<uint8_t> m_coalescedSlots;
 
-    std::atomic<uint16_t> m_activationKeycode{KEY_LEFTSHIFT};
-    bool m_activationPressed{false};
+    // Only m_producerThread pushes; the controller thread pops.
+    SpscQueue<ControllerCommand, 256> m_commands;
+    QThread *m_producerThread{nullptr};
 
-    const uint16_t m_keycodeA{KEY_A};
-    const uint16_t m_keycodeD{KEY_D};
-    uint16_t m_currentlyPressedKeycode{0};
+    std::variant<PlainEngine, RandomizedEngine> m_engine;
+    int m_randomizerMinimum{70};
+    int m_randomizerMaximum{90};
+    UinputFrame m_frame;
+    uint64_t m_frameSourceUsec{0};
+    quint32 m_frameDeviceId{0};
+    LatencyHistogram m_latency;
+    RuntimeCounters m_counters;
+    std::atomic<bool> m_telemetryEnabled{false};
+    MotionTelemetry m_telemetry;
+
+    ControllerStatus m_status;
+    SeqLock<ControllerStatus> m_publishedStatus;
 
     std::chrono::steady_clock::time_point m_lastMotion;
+    std::chrono::milliseconds m_idleReleaseInterval{150};
+
+    // The pointer whose motion holds the current key. Other pointers are ignored until it
+    // has been still for its own idle-release interval, so a touchpad resting under a palm
+    // cannot flip the key a mouse is holding.
+    static constexpr uint8_t kNoMotionOwner = 0xFF;
+    PointerStateTable m_pointerStates;
+    uint8_t m_motionOwner{kNoMotionOwner};
 
-    std::mt19937 m_randomEngine;
-    std::uniform_real_distribution<double> m_unitDistribution;
+    QHash<quint64, CalibrationResult> m_calibrations;
+    std::unordered_map<const InputDevice *, MotionCalibrator> m_calibrators;
+    bool m_calibrating{false};
 
-    QStringList m_pointerAllowedBrands;
-    QStringList m_pointerBlockedBrands;
-    QStringList m_keyboardAllowedBrands;
-    QStringList m_keyboardBlockedBrands;
+    BrandMatcher m_pointerFilter;
+    BrandMatcher m_keyboardFilter;
 
-    QMutex m_deviceMutex;
-    QString m_pointerDeviceName;
-    QString m_keyboardDeviceName;
-    bool m_pointerDetected{false};
-    bool m_keyboardDetected{false};
+    QVector<InputDevice *> m_devices;
+    const InputDevice *m_pointerDevice{nullptr};
+    const InputDevice *m_keyboardDevice{nullptr};
+    bool m_devicesChanged{false};
+    QString m_publishedPointer;
+    QString m_publishedKeyboard;
 
+    // At most one prompt is open at a time: the nodes asked for up front, or the first node
+    // that turned out inaccessible later. Nodes hitting EACCES meanwhile are collected and
+    // asked for once it is answered. The controller runs on whatever did open and never
+    // waits; refused nodes are not asked for again until restart.
     QMutex m_accessMutex;
-    QWaitCondition m_accessWait;
-    bool m_accessDecisionPending{false};
-    bool m_accessGranted{false};
-    QString m_pendingAccessPath;
+    bool m_accessPending{false};
+    QStringList m_accessBatch;
+    QStringList m_accessLatePaths;
+    // Answered but not yet applied on the controller thread.
+    QStringList m_accessGranted;
+    QStringList m_accessRefused;
 };
@@ -0,0 +1,104 @@
+#include "latencyhistogram.h"
+
+#include <algorithm>
+
+std::size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < 2 * kSubBucketCount) {
+        return static_cast<std::size_t>(value);
+    }
+
+    const unsigned exponent = std::min<unsigned>(63U - static_cast<unsigned>(__builtin_clzll(value)), kMaxExponent);
+    if (exponent == kMaxExponent && (value >> kMaxExponent) > 1) {
+        return kBucketCount - 1;
+    }
+
+    const uint64_t subBucket = value >> (exponent - kSubBucketBits);
+    return static_cast<std::size_t>((exponent - kSubBucketBits) * kSubBucketCount + subBucket);
+}
+
+uint64_t LatencyHistogram::bucketLower(std::size_t index)
+{
+    if (index < 2 * kSubBucketCount) {
+        return index;
+    }
+
+    const unsigned exponent = static_cast<unsigned>(index / kSubBucketCount) + kSubBucketBits - 1;
+    const uint64_t subBucket = index % kSubBucketCount + kSubBucketCount;
+    return subBucket << (exponent - kSubBucketBits);
+}
+
+uint64_t LatencyHistogram::bucketUpper(std::size_t index)
+{
+    if (index < 2 * kSubBucketCount) {
+        return index;
+    }
+
+    const unsigned exponent = static_cast<unsigned>(index / kSubBucketCount) + kSubBucketBits - 1;
+    return bucketLower(index) + (1ULL << (exponent - kSubBucketBits)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+    std::atomic<uint64_t> &bucket = m_buckets[bucketIndex(nanoseconds)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (nanoseconds > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<uint64_t> &bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const
+{
+    std::array<uint64_t, kBucketCount> counts{};
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    Summary result;
+    result.count = total;
+    result.max = m_max.load(std::memory_order_relaxed);
+    if (total == 0) {
+        return result;
+    }
+
+    const auto percentile = [&](uint64_t permille) {
+        const uint64_t rank = std::max<uint64_t>(1, (total * permille + 999) / 1000);
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(bucketUpper(i), result.max);
+            }
+        }
+        return result.max;
+    };
+
+    result.p50 = percentile(500);
+    result.p95 = percentile(950);
+    result.p99 = percentile(990);
+    return result;
+}
+
+std::vector<LatencyHistogram::Bucket> LatencyHistogram::buckets() const
+{
+    std::vector<Bucket> result;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+        if (count != 0) {
+            result.push_back({bucketLower(i), bucketUpper(i), count});
+        }
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Log-linear (HDR-style) histogram of nanosecond latencies with ~3% bucket precision.
+// record() and reset() belong to a single writer thread; summary() and buckets() may be
+// called concurrently from any thread and never block the writer.
+class LatencyHistogram
+{
+public:
+    struct Summary {
+        uint64_t count{0};
+        uint64_t p50{0};
+        uint64_t p95{0};
+        uint64_t p99{0};
+        uint64_t max{0};
+    };
+
+    struct Bucket {
+        uint64_t lowerNs{0};
+        uint64_t upperNs{0};
+        uint64_t count{0};
+    };
+
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    Summary summary() const;
+    std::vector<Bucket> buckets() const;
+
+private:
+    static constexpr unsigned kSubBucketBits = 5;
+    static constexpr uint64_t kSubBucketCount = 1ULL << kSubBucketBits;
+    static constexpr unsigned kMaxExponent = 39;
+    static constexpr std::size_t kBucketCount = (kMaxExponent - kSubBucketBits) * kSubBucketCount + 2 * kSubBucketCount;
+
+    static std::size_t bucketIndex(uint64_t value);
+    static uint64_t bucketLower(std::size_t index);
+    static uint64_t bucketUpper(std::size_t index);
+
+    std::array<std::atomic<uint64_t>, kBucketCount> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_max{0};
+};
@@ -0,0 +1,442 @@
+#include "libinputbackend.h"
+
+#include "devicenodes.h"
+
+#include <QFile>
+#include <QtGlobal>
+
+#include <libinput.h>
+#include <libudev.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+const libinput_interface kInterface = {
+    .open_restricted = &LibinputBackend::openRestricted,
+    .close_restricted = &LibinputBackend::closeRestricted,
+};
+
+quint32 hexAttribute(udev_device *device, const char *name)
+{
+    const char *value = udev_device_get_sysattr_value(device, name);
+    return value ? static_cast<quint32>(std::strtoul(value, nullptr, 16)) : 0;
+}
+}
+
+LibinputBackend::LibinputBackend(InputBackendHost &host)
+    : InputBackend(host)
+{
+}
+
+LibinputBackend::~LibinputBackend()
+{
+    close();
+}
+
+int LibinputBackend::openRestricted(const char *path, int flags, void *userData)
+{
+    auto *backend = static_cast<LibinputBackend *>(userData);
+    const QString devicePath = QString::fromLocal8Bit(path);
+
+    for (;;) {
+        int fd = ::open(path, flags | O_CLOEXEC);
+        if (fd >= 0) {
+            return fd;
+        }
+
+        const int error = errno;
+        if (!backend || (error != EACCES && error != EPERM)) {
+            return -error;
+        }
+
+        if (!backend->m_host.requestDeviceAccess(devicePath)) {
+            return -error;
+        }
+    }
+}
+
+void LibinputBackend::closeRestricted(int fd, void *userData)
+{
+    Q_UNUSED(userData);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void LibinputBackend::setCachedDevices(const QVector<CachedDevice> &devices)
+{
+    m_cachedDevices.clear();
+    for (const CachedDevice &device : devices) {
+        if (!device.node.isEmpty()) {
+            m_cachedDevices.append(device);
+        }
+    }
+}
+
+QStringList LibinputBackend::requiredNodes()
+{
+    if (!m_udev) {
+        m_udev = udev_new();
+    }
+
+    if (!m_cachedDevices.isEmpty()) {
+        QStringList nodes;
+        for (const CachedDevice &cached : m_cachedDevices) {
+            if (!matchesCachedDevice(cached)) {
+                nodes.clear();
+                break;
+            }
+            nodes.append(cached.node);
+        }
+        if (!nodes.isEmpty()) {
+            return nodes;
+        }
+    }
+    return pointerAndKeyboardNodes(m_udev);
+}
+
+void LibinputBackend::reopenDevices(const QStringList &devicePaths)
+{
+    if (!m_libinput) {
+        return;
+    }
+
+    if (m_pathMode) {
+        for (const QString &path : devicePaths) {
+            addPathDevice(QFile::encodeName(path).constData());
+        }
+        return;
+    }
+
+    // A seat context has no way to retry a single node; resuming re-enumerates the seat.
+    libinput_suspend(m_libinput);
+    libinput_resume(m_libinput);
+}
+
+bool LibinputBackend::open(QString &errorText)
+{
+    if (!m_udev) {
+        m_udev = udev_new();
+    }
+    if (!m_udev) {
+        errorText = QStringLiteral("Не вдалося створити контекст udev.");
+        return false;
+    }
+
+    if (!m_cachedDevices.isEmpty() && openCached(errorText)) {
+        return true;
+    }
+    return openSeat(errorText);
+}
+
+bool LibinputBackend::openSeat(QString &errorText)
+{
+    m_libinput = libinput_udev_create_context(&kInterface, this, m_udev);
+    if (!m_libinput) {
+        errorText = QStringLiteral("Не вдалося створити контекст libinput. Переконайтеся, що маєте доступ до /dev/input/*.");
+        udev_unref(m_udev);
+        m_udev = nullptr;
+        return false;
+    }
+
+    if (libinput_udev_assign_seat(m_libinput, "seat0") != 0) {
+        errorText = QStringLiteral("Не вдалося підключитися до seat0. Перевірте доступ seatd чи запустіть додаток з sudo.");
+        libinput_unref(m_libinput);
+        m_libinput = nullptr;
+        udev_unref(m_udev);
+        m_udev = nullptr;
+        return false;
+    }
+
+    libinput_dispatch(m_libinput);
+    return true;
+}
+
+bool LibinputBackend::openCached(QString &errorText)
+{
+    m_libinput = libinput_path_create_context(&kInterface, this);
+    m_monitor = udev_monitor_new_from_netlink(m_udev, "udev");
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_scanFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    const bool ready = m_libinput && m_monitor && m_epollFd >= 0 && m_scanFd >= 0 &&
+                       udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "input", nullptr) >= 0 &&
+                       udev_monitor_enable_receiving(m_monitor) >= 0;
+
+    if (ready) {
+        for (int fd : {libinput_get_fd(m_libinput), udev_monitor_get_fd(m_monitor), m_scanFd}) {
+            epoll_event registration{};
+            registration.events = EPOLLIN;
+            registration.data.fd = fd;
+            if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &registration) < 0) {
+                errorText = QStringLiteral("Не вдалося зареєструвати дескриптор libinput в epoll: %1").arg(QString::fromLocal8Bit(strerror(errno)));
+                break;
+            }
+        }
+    }
+
+    if (!ready || !errorText.isEmpty()) {
+        // Not fatal: the seat context does not need any of this.
+        errorText.clear();
+        if (m_libinput) {
+            libinput_unref(m_libinput);
+            m_libinput = nullptr;
+        }
+        if (m_monitor) {
+            udev_monitor_unref(m_monitor);
+            m_monitor = nullptr;
+        }
+        if (m_scanFd >= 0) {
+            ::close(m_scanFd);
+            m_scanFd = -1;
+        }
+        if (m_epollFd >= 0) {
+            ::close(m_epollFd);
+            m_epollFd = -1;
+        }
+        return false;
+    }
+
+    m_pathMode = true;
+    bool missed = false;
+    for (const CachedDevice &cached : m_cachedDevices) {
+        if (matchesCachedDevice(cached)) {
+            addPathDevice(QFile::encodeName(cached.node).constData());
+        } else {
+            missed = true;
+        }
+    }
+
+    // The nodes that did match are usable right away; the rest of the seat is searched
+    // from the first dispatch, once the controller is already running.
+    if (missed || m_pathNodes.isEmpty()) {
+        const uint64_t increment = 1;
+        while (write(m_scanFd, &increment, sizeof(increment)) < 0 && errno == EINTR) {
+        }
+    }
+    libinput_dispatch(m_libinput);
+    return true;
+}
+
+bool LibinputBackend::matchesCachedDevice(const CachedDevice &cached) const
+{
+    struct stat info{};
+    if (stat(QFile::encodeName(cached.node).constData(), &info) != 0 || !S_ISCHR(info.st_mode)) {
+        return false;
+    }
+
+    udev_device *node = udev_device_new_from_devnum(m_udev, 'c', info.st_rdev);
+    if (!node) {
+        return false;
+    }
+
+    bool matches = false;
+    if (isPointerOrKeyboardNode(node)) {
+        // The event node's parent carries the same name and ids libinput reports.
+        udev_device *input = udev_device_get_parent_with_subsystem_devtype(node, "input", nullptr);
+        if (input) {
+            const char *name = udev_device_get_sysattr_value(input, "name");
+            matches = name && QString::fromLocal8Bit(name) == cached.name &&
+                      hexAttribute(input, "id/vendor") == cached.vendor &&
+                      hexAttribute(input, "id/product") == cached.product;
+        }
+    }
+    udev_device_unref(node);
+    return matches;
+}
+
+void LibinputBackend::addPathDevice(const char *devnode)
+{
+    const QString node = QString::fromLocal8Bit(devnode);
+    if (m_pathNodes.contains(node)) {
+        return;
+    }
+    // DEVICE_ADDED arrives through the normal event queue and creates the InputDevice.
+    if (libinput_path_add_device(m_libinput, devnode)) {
+        m_pathNodes.append(node);
+    }
+}
+
+void LibinputBackend::scanSeat()
+{
+    for (const QString &node : pointerAndKeyboardNodes(m_udev)) {
+        addPathDevice(QFile::encodeName(node).constData());
+    }
+}
+
+void LibinputBackend::handleMonitor()
+{
+    // Removal needs no help: libinput drops a path device by itself once its node is gone.
+    while (udev_device *device = udev_monitor_receive_device(m_monitor)) {
+        const char *action = udev_device_get_action(device);
+        if (action && std::strcmp(action, "add") == 0 && isPointerOrKeyboardNode(device)) {
+            addPathDevice(udev_device_get_devnode(device));
+        }
+        udev_device_unref(device);
+    }
+}
+
+void LibinputBackend::close()
+{
+    if (m_libinput) {
+        libinput_unref(m_libinput);
+        m_libinput = nullptr;
+    }
+    if (m_monitor) {
+        udev_monitor_unref(m_monitor);
+        m_monitor = nullptr;
+    }
+    if (m_udev) {
+        udev_unref(m_udev);
+        m_udev = nullptr;
+    }
+    if (m_scanFd >= 0) {
+        ::close(m_scanFd);
+        m_scanFd = -1;
+    }
+    if (m_epollFd >= 0) {
+        ::close(m_epollFd);
+        m_epollFd = -1;
+    }
+    m_pathMode = false;
+    m_pathNodes.clear();
+    m_devices.clear();
+}
+
+int LibinputBackend::fd() const
+{
+    if (m_pathMode) {
+        return m_epollFd;
+    }
+    return m_libinput ? libinput_get_fd(m_libinput) : -1;
+}
+
+bool LibinputBackend::dispatch(QString &errorText)
+{
+    if (!m_libinput) {
+        errorText = QStringLiteral("Контекст libinput не ініціалізовано.");
+        return false;
+    }
+
+    if (m_pathMode) {
+        std::array<epoll_event, 3> ready{};
+        const int count = epoll_wait(m_epollFd, ready.data(), static_cast<int>(ready.size()), 0);
+        for (int i = 0; i < count; ++i) {
+            if (ready[i].data.fd == m_scanFd) {
+                uint64_t counter = 0;
+                while (read(m_scanFd, &counter, sizeof(counter)) < 0 && errno == EINTR) {
+                }
+                scanSeat();
+            } else if (ready[i].data.fd == udev_monitor_get_fd(m_monitor)) {
+                handleMonitor();
+            }
+        }
+    }
+
+    libinput_dispatch(m_libinput);
+    libinput_event *event = nullptr;
+    while ((event = libinput_get_event(m_libinput)) != nullptr) {
+        translateEvent(event);
+        libinput_event_destroy(event);
+    }
+    return true;
+}
+
+void LibinputBackend::translateEvent(libinput_event *event)
+{
+    libinput_device *device = libinput_event_get_device(event);
+    if (!device) {
+        return;
+    }
+
+    InputEvent translated;
+    switch (libinput_event_get_type(event)) {
+    case LIBINPUT_EVENT_POINTER_MOTION: {
+        libinput_event_pointer *pointerEvent = libinput_event_get_pointer_event(event);
+        translated.type = InputEvent::Type::PointerMotion;
+        translated.timeUsec = libinput_event_pointer_get_time_usec(pointerEvent);
+        translated.dx = libinput_event_pointer_get_dx(pointerEvent);
+        translated.dxUnaccelerated = libinput_event_pointer_get_dx_unaccelerated(pointerEvent);
+        translated.dy = libinput_event_pointer_get_dy(pointerEvent);
+        translated.dyUnaccelerated = libinput_event_pointer_get_dy_unaccelerated(pointerEvent);
+        break;
+    }
+    case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE: {
+        // The dx/dy getters are only defined for relative motion.
+        libinput_event_pointer *pointerEvent = libinput_event_get_pointer_event(event);
+        translated.type = InputEvent::Type::PointerMotionAbsolute;
+        translated.timeUsec = libinput_event_pointer_get_time_usec(pointerEvent);
+        translated.absoluteX = libinput_event_pointer_get_absolute_x(pointerEvent);
+        translated.absoluteY = libinput_event_pointer_get_absolute_y(pointerEvent);
+        break;
+    }
+    case LIBINPUT_EVENT_KEYBOARD_KEY: {
+        libinput_event_keyboard *keyboardEvent = libinput_event_get_keyboard_event(event);
+        translated.type = InputEvent::Type::KeyboardKey;
+        translated.timeUsec = libinput_event_keyboard_get_time_usec(keyboardEvent);
+        translated.key = libinput_event_keyboard_get_key(keyboardEvent);
+        translated.pressed = (libinput_event_keyboard_get_key_state(keyboardEvent) == LIBINPUT_KEY_STATE_PRESSED);
+        break;
+    }
+    case LIBINPUT_EVENT_DEVICE_ADDED:
+        translated.type = InputEvent::Type::DeviceAdded;
+        break;
+    case LIBINPUT_EVENT_DEVICE_REMOVED:
+        translated.type = InputEvent::Type::DeviceRemoved;
+        break;
+    default:
+        return;
+    }
+
+    translated.device = deviceFor(device);
+    m_host.handleInputEvent(translated);
+
+    if (translated.type == InputEvent::Type::DeviceRemoved) {
+        releaseDevice(device);
+    }
+}
+
+InputDevice *LibinputBackend::deviceFor(libinput_device *device)
+{
+    auto *info = static_cast<InputDevice *>(libinput_device_get_user_data(device));
+    if (info) {
+        return info;
+    }
+
+    m_devices.push_back(std::make_unique<InputDevice>());
+    info = m_devices.back().get();
+    info->name = QString::fromLocal8Bit(libinput_device_get_name(device));
+    info->sysname = QString::fromLocal8Bit(libinput_device_get_sysname(device));
+    if (udev_device *node = libinput_device_get_udev_device(device)) {
+        info->devnode = QString::fromLocal8Bit(udev_device_get_devnode(node));
+        udev_device_unref(node);
+    }
+    info->vendor = libinput_device_get_id_vendor(device);
+    info->product = libinput_device_get_id_product(device);
+    info->pointer = libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_POINTER) ||
+                    libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_GESTURE);
+    info->keyboard = libinput_device_has_capability(device, LIBINPUT_DEVICE_CAP_KEYBOARD);
+    libinput_device_set_user_data(device, info);
+    return info;
+}
+
+void LibinputBackend::releaseDevice(libinput_device *device)
+{
+    auto *info = static_cast<InputDevice *>(libinput_device_get_user_data(device));
+    libinput_device_set_user_data(device, nullptr);
+    if (info) {
+        m_pathNodes.removeAll(info->devnode);
+    }
+    m_devices.erase(std::remove_if(m_devices.begin(), m_devices.end(),
+                                   [info](const std::unique_ptr<InputDevice> &entry) { return entry.get() == info; }),
+                    m_devices.end());
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "inputbackend.h"
+
+#include <QStringList>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+struct libinput;
+struct libinput_device;
+struct libinput_event;
+struct udev;
+struct udev_device;
+struct udev_monitor;
+
+class LibinputBackend : public InputBackend
+{
+public:
+    explicit LibinputBackend(InputBackendHost &host);
+    ~LibinputBackend() override;
+
+    Kind kind() const override { return Kind::Libinput; }
+    bool open(QString &errorText) override;
+    void close() override;
+    int fd() const override;
+    bool dispatch(QString &errorText) override;
+    QStringList requiredNodes() override;
+    void reopenDevices(const QStringList &devicePaths) override;
+
+    // Takes effect on the next open(). Cached nodes that still identify the same device
+    // are opened on a path context instead of assigning the whole seat; if any of them
+    // misses, the seat's pointers and keyboards are added by a scan after startup.
+    void setCachedDevices(const QVector<CachedDevice> &devices);
+
+    static int openRestricted(const char *path, int flags, void *userData);
+    static void closeRestricted(int fd, void *userData);
+
+private:
+    bool openSeat(QString &errorText);
+    bool openCached(QString &errorText);
+    bool matchesCachedDevice(const CachedDevice &cached) const;
+    void addPathDevice(const char *devnode);
+    void scanSeat();
+    void handleMonitor();
+    void translateEvent(libinput_event *event);
+    InputDevice *deviceFor(libinput_device *device);
+    void releaseDevice(libinput_device *device);
+
+    libinput *m_libinput{nullptr};
+    udev *m_udev{nullptr};
+    std::vector<std::unique_ptr<InputDevice>> m_devices;
+    QVector<CachedDevice> m_cachedDevices;
+
+    // Path mode only: libinput, the udev hotplug monitor and the deferred scan share one
+    // epoll descriptor so the controller still sees a single fd.
+    bool m_pathMode{false};
+    QStringList m_pathNodes;
+    udev_monitor *m_monitor{nullptr};
+    int m_epollFd{-1};
+    int m_scanFd{-1};
+};
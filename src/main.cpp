@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
 #include <QLibraryInfo>
 #include <QLocale>
 #include <QTranslator>
@@ -16,8 +18,18 @@ int main(int argc, char *argv[])
         application.installTranslator(&translator);
     }
 
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Mouse Direction Sync"));
+    parser.addHelpOption();
+    const QCommandLineOption trayOption(QStringLiteral("tray"),
+                                        QStringLiteral("Запуститися згорнутим у системний трей; вікно створюється лише при відкритті."));
+    parser.addOption(trayOption);
+    parser.process(application);
+
     MainWindow window;
-    window.show();
+    if (!parser.isSet(trayOption) || !window.enableTrayMode()) {
+        window.openWindow();
+    }
 
     return application.exec();
 }
@@ -1,6 +1,8 @@
 #include "mainwindow.h"
 
+#include "configwatcher.h"
 #include "inputcontroller.h"
+#include "telemetrygraph.h"
 
 #include <QApplication>
 #include <QCheckBox>
@@ -8,29 +10,53 @@
 #include <QCloseEvent>
 #include <QComboBox>
 #include <QDir>
+#include <QFile>
+#include <QFileDialog>
 #include <QFrame>
 #include <QHBoxLayout>
+#include <QHideEvent>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QIcon>
 #include <QLabel>
+#include <QMenu>
 #include <QMessageBox>
 #include <QPalette>
 #include <QProcess>
 #include <QPushButton>
-#include <QSettings>
+#include <QShowEvent>
 #include <QSlider>
 #include <QSpacerItem>
 #include <QStandardPaths>
+#include <QSystemTrayIcon>
+#include <QTextStream>
+#include <QTimer>
 #include <QVariant>
 #include <QVBoxLayout>
-#include <QFileInfo>
 
 #include <QtGlobal>
 
 #include <algorithm>
+#include <utility>
 
 #include <linux/input-event-codes.h>
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
 namespace
 {
+constexpr int kStatusRefreshIntervalMs = 16;
+constexpr int kDiagnosticsRefreshIntervalMs = 500;
+constexpr int kCalibrationDurationMs = 5000;
+
+QString formatMicroseconds(quint64 nanoseconds)
+{
+    return QString::number(static_cast<double>(nanoseconds) / 1000.0, 'f', 1);
+}
+
 QString formatPercentLabel(const QString &label, int value)
 {
     return QStringLiteral("%1: %2%")
@@ -42,32 +68,42 @@ QString formatPercentLabel(const QString &label, int value)
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_controller(new InputController(this))
+    , m_settingsSaver(m_settingsStore.fileName())
 {
     setWindowTitle(QStringLiteral("Mouse Direction Sync"));
     resize(520, 560);
 
-    const QString configPath = configFilePath();
-    QFileInfo configInfo(configPath);
-    QDir().mkpath(configInfo.absolutePath());
-
-    m_settings = new QSettings(configPath, QSettings::IniFormat, this);
-    m_settings->setFallbacksEnabled(false);
     loadSettings();
 
-    buildInterface();
-    populateKeyOptions();
-    applyTheme(m_currentTheme);
-
+    // The controller comes first; the widget tree waits for openWindow().
     connect(m_controller, &InputController::statusChanged, this, &MainWindow::updateStatusLabel);
     connect(m_controller, &InputController::errorOccurred, this, &MainWindow::presentError);
     connect(m_controller, &InputController::accessConfirmationRequested, this, &MainWindow::showAccessPrompt);
-    connect(m_controller, &InputController::devicesDetected, this, &MainWindow::updateDeviceLabels);
+    connect(m_controller, &InputController::inventoryChanged, this, &MainWindow::updateDeviceInventory);
+    connect(m_controller, &InputController::cachedDevicesChanged, this, &MainWindow::handleCachedDevicesChanged);
+    connect(m_controller, &InputController::realtimeStatusReported, this, &MainWindow::updateRealtimeLabel);
+    connect(m_controller, &InputController::calibrationFinished, this, &MainWindow::handleCalibrationFinished);
+    connect(&m_settingsSaver, &SettingsSaver::saveFailed, this, &MainWindow::presentError);
 
-    m_controller->setPointerBrandFilters(m_pointerAllowedBrands, m_pointerBlockedBrands);
-    m_controller->setKeyboardBrandFilters(m_keyboardAllowedBrands, m_keyboardBlockedBrands);
+    configureController(*m_controller, m_config);
     m_controller->start();
 
-    restoreSettings();
+    m_configWatcher = new ConfigWatcher(m_settingsStore.fileName(), this);
+    connect(m_configWatcher, &ConfigWatcher::changed, this, &MainWindow::reloadSettings);
+    QString watchError;
+    if (!m_configWatcher->start(watchError)) {
+        updateStatusLabel(QStringLiteral("Зміни INI-файлу не відстежуються: %1").arg(watchError));
+    }
+
+    m_statusTimer = new QTimer(this);
+    m_statusTimer->setInterval(kStatusRefreshIntervalMs);
+    connect(m_statusTimer, &QTimer::timeout, this, &MainWindow::refreshControllerStatus);
+
+    m_diagnosticsTimer = new QTimer(this);
+    m_diagnosticsTimer->setInterval(kDiagnosticsRefreshIntervalMs);
+    connect(m_diagnosticsTimer, &QTimer::timeout, this, &MainWindow::refreshDiagnostics);
+
+    saveSettings();
 }
 
 MainWindow::~MainWindow()
@@ -78,8 +114,76 @@ MainWindow::~MainWindow()
     }
 }
 
+bool MainWindow::enableTrayMode()
+{
+    if (m_trayIcon) {
+        return true;
+    }
+    if (!QSystemTrayIcon::isSystemTrayAvailable()) {
+        return false;
+    }
+
+    auto *menu = new QMenu(this);
+    QAction *openAction = menu->addAction(QStringLiteral("Відкрити"));
+    menu->addSeparator();
+    QAction *quitAction = menu->addAction(QStringLiteral("Вийти"));
+    connect(openAction, &QAction::triggered, this, &MainWindow::openWindow);
+    connect(quitAction, &QAction::triggered, qApp, &QApplication::quit);
+
+    m_trayIcon = new QSystemTrayIcon(QIcon::fromTheme(QStringLiteral("input-mouse")), this);
+    m_trayIcon->setToolTip(windowTitle());
+    m_trayIcon->setContextMenu(menu);
+    connect(m_trayIcon, &QSystemTrayIcon::activated, this, [this](QSystemTrayIcon::ActivationReason reason) {
+        if (reason != QSystemTrayIcon::Trigger && reason != QSystemTrayIcon::DoubleClick) {
+            return;
+        }
+        if (isVisible()) {
+            hide();
+        } else {
+            openWindow();
+        }
+    });
+    m_trayIcon->show();
+    QApplication::setQuitOnLastWindowClosed(false);
+    return true;
+}
+
+void MainWindow::openWindow()
+{
+    ensureInterface();
+    showNormal();
+    raise();
+    activateWindow();
+}
+
+void MainWindow::showEvent(QShowEvent *event)
+{
+    m_statusTimer->start();
+    m_diagnosticsTimer->start();
+    m_wakeupClock.invalidate();
+    QMainWindow::showEvent(event);
+}
+
+// Polling a window nobody sees would be the only periodic wakeup left in the process.
+void MainWindow::hideEvent(QHideEvent *event)
+{
+    m_statusTimer->stop();
+    m_diagnosticsTimer->stop();
+    if (m_trayIcon) {
+        QTimer::singleShot(0, this, &MainWindow::teardownInterface);
+    }
+    QMainWindow::hideEvent(event);
+}
+
 void MainWindow::closeEvent(QCloseEvent *event)
 {
+    if (m_trayIcon) {
+        event->ignore();
+        hide();
+        return;
+    }
+
+    m_settingsSaver.flush();
     if (m_controller) {
         m_controller->stopController();
         m_controller->wait(1000);
@@ -95,24 +199,24 @@ void MainWindow::handleActivationChanged(int index)
 
     const quint32 keycode = m_activationCombo->itemData(index).toUInt();
     m_controller->setActivationKeycode(keycode);
-    m_initialActivationKey = keycode;
+    m_config.activationKey = keycode;
     saveSettings();
 }
 
 void MainWindow::handleRandomizerToggled(bool checked)
 {
-    m_randomizerInitiallyEnabled = checked;
+    m_config.randomizerEnabled = checked;
     refreshRandomizerControls();
     saveSettings();
 }
 
 void MainWindow::handleMinRangeChanged(int value)
 {
-    m_minSync = value;
-    if (m_minSync > m_maxSync) {
-        m_maxSync = m_minSync;
+    m_config.randomizerMinimum = value;
+    if (m_config.randomizerMinimum > m_config.randomizerMaximum) {
+        m_config.randomizerMaximum = m_config.randomizerMinimum;
         m_maxSlider->blockSignals(true);
-        m_maxSlider->setValue(m_maxSync);
+        m_maxSlider->setValue(m_config.randomizerMaximum);
         m_maxSlider->blockSignals(false);
     }
     updateRangeLabels();
@@ -122,11 +226,11 @@ void MainWindow::handleMinRangeChanged(int value)
 
 void MainWindow::handleMaxRangeChanged(int value)
 {
-    m_maxSync = value;
-    if (m_maxSync < m_minSync) {
-        m_minSync = m_maxSync;
+    m_config.randomizerMaximum = value;
+    if (m_config.randomizerMaximum < m_config.randomizerMinimum) {
+        m_config.randomizerMinimum = m_config.randomizerMaximum;
         m_minSlider->blockSignals(true);
-        m_minSlider->setValue(m_minSync);
+        m_minSlider->setValue(m_config.randomizerMinimum);
         m_minSlider->blockSignals(false);
     }
     updateRangeLabels();
@@ -153,57 +257,362 @@ void MainWindow::updateStatusLabel(const QString &statusText)
     m_statusLabel->setText(QStringLiteral("Статус: %1").arg(statusText));
 }
 
+void MainWindow::refreshControllerStatus()
+{
+    const ControllerStatus status = m_controller->statusSnapshot();
+    if (status.version == 0 || status.version == m_lastStatusVersion) {
+        return;
+    }
+    m_lastStatusVersion = status.version;
+
+    switch (status.phase) {
+    case ControllerStatus::Phase::Initialising:
+        updateStatusLabel(QStringLiteral("Ініціалізація пристроїв..."));
+        break;
+    case ControllerStatus::Phase::Ready:
+        updateStatusLabel(QStringLiteral("Готово. Затисніть клавішу активації."));
+        break;
+    case ControllerStatus::Phase::Active:
+        updateStatusLabel(QStringLiteral("Активно."));
+        break;
+    case ControllerStatus::Phase::Holding:
+        updateStatusLabel(QStringLiteral("Утримується клавіша %1.").arg(keyLabel(status.activeKeycode)));
+        break;
+    case ControllerStatus::Phase::Paused:
+        updateStatusLabel(QStringLiteral("Призупинено."));
+        break;
+    case ControllerStatus::Phase::ActivationUpdated:
+        updateStatusLabel(QStringLiteral("Клавіша активації оновлена."));
+        break;
+    case ControllerStatus::Phase::Stopped:
+        updateStatusLabel(QStringLiteral("Зупинено."));
+        break;
+    }
+}
+
+void MainWindow::refreshDiagnostics()
+{
+    if (!m_latencyLabel) {
+        return;
+    }
+
+    const RuntimeCounters &counters = m_controller->runtimeCounters();
+    const auto count = [&counters](RuntimeCounters::Counter counter) { return QString::number(counters.value(counter)); };
+
+    const quint64 wakeups = counters.value(RuntimeCounters::LoopWakeups);
+    if (!m_wakeupClock.isValid()) {
+        m_wakeupClock.start();
+    } else if (const qint64 elapsedMs = m_wakeupClock.restart(); elapsedMs > 0) {
+        m_wakeupsLabel->setText(QStringLiteral("Пробуджень контролера за секунду: %1")
+                                    .arg(static_cast<double>(wakeups - m_lastWakeups) * 1000.0 / static_cast<double>(elapsedMs), 0, 'f', 1));
+    }
+    m_lastWakeups = wakeups;
+    m_countersLabel->setText(QStringLiteral("Цикл: пробуджень %1 · рух %2 (абсолютний %3) · клавіші %4 · пристрої +%5/−%6\n"
+                                            "Відкинуто: фільтром руху %7, фільтром клавіатури %8, порогом %9")
+                                 .arg(count(RuntimeCounters::LoopWakeups), count(RuntimeCounters::PointerMotionEvents),
+                                      count(RuntimeCounters::AbsoluteMotionEvents), count(RuntimeCounters::KeyboardKeyEvents),
+                                      count(RuntimeCounters::DeviceAddedEvents), count(RuntimeCounters::DeviceRemovedEvents),
+                                      count(RuntimeCounters::FilteredPointerEvents), count(RuntimeCounters::FilteredKeyboardEvents),
+                                      count(RuntimeCounters::ThresholdRejections)) +
+                             QStringLiteral(", рандомізатором %1, іншим вказівником %2 · uinput: записів %3, помилок %4 · автовідпускань %5")
+                                 .arg(count(RuntimeCounters::RandomizerRejections), count(RuntimeCounters::PointerArbitrationRejections),
+                                      count(RuntimeCounters::UinputWrites), count(RuntimeCounters::UinputWriteErrors),
+                                      count(RuntimeCounters::IdleReleases)));
+
+    const LatencyHistogram::Summary summary = m_controller->latencyHistogram().summary();
+    if (summary.count == 0) {
+        m_latencyLabel->setText(QStringLiteral("Затримка подія → uinput: ще немає вимірювань"));
+        return;
+    }
+
+    m_latencyLabel->setText(QStringLiteral("Затримка подія → uinput, мкс: p50 %1 · p95 %2 · p99 %3 · max %4 (n = %5)")
+                                .arg(formatMicroseconds(summary.p50),
+                                     formatMicroseconds(summary.p95),
+                                     formatMicroseconds(summary.p99),
+                                     formatMicroseconds(summary.max))
+                                .arg(summary.count));
+}
+
+void MainWindow::exportLatencyHistogram()
+{
+    const QString path = QFileDialog::getSaveFileName(this,
+                                                      QStringLiteral("Експорт гістограми затримок"),
+                                                      QDir::home().filePath(QStringLiteral("mdb-latency.csv")),
+                                                      QStringLiteral("CSV (*.csv)"));
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        QMessageBox::warning(this, QStringLiteral("Помилка"), QStringLiteral("Не вдалося записати %1: %2").arg(path, file.errorString()));
+        return;
+    }
+
+    const LatencyHistogram &histogram = m_controller->latencyHistogram();
+    const LatencyHistogram::Summary summary = histogram.summary();
+    QTextStream stream(&file);
+    stream << "# count,p50_ns,p95_ns,p99_ns,max_ns\n";
+    stream << "# " << summary.count << ',' << summary.p50 << ',' << summary.p95 << ',' << summary.p99 << ',' << summary.max << '\n';
+    stream << "lower_ns,upper_ns,count\n";
+    for (const LatencyHistogram::Bucket &bucket : histogram.buckets()) {
+        stream << bucket.lowerNs << ',' << bucket.upperNs << ',' << bucket.count << '\n';
+    }
+}
+
+void MainWindow::exportRuntimeCounters()
+{
+    const QString path = QFileDialog::getSaveFileName(this,
+                                                      QStringLiteral("Експорт лічильників"),
+                                                      QDir::home().filePath(QStringLiteral("mdb-counters.json")),
+                                                      QStringLiteral("JSON (*.json)"));
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, QStringLiteral("Помилка"), QStringLiteral("Не вдалося записати %1: %2").arg(path, file.errorString()));
+        return;
+    }
+
+    QJsonObject root = m_controller->runtimeCounters().toJson();
+    const ControllerStatus status = m_controller->statusSnapshot();
+    root.insert(QStringLiteral("transitions"), QJsonValue(static_cast<qint64>(status.transitions)));
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+}
+
+void MainWindow::startCalibration()
+{
+    if (!m_calibrateButton) {
+        return;
+    }
+
+    m_calibrateButton->setEnabled(false);
+    m_calibrationLabel->setText(QStringLiteral("Калібрування: рухайте мишею ліворуч і праворуч протягом %1 с...").arg(kCalibrationDurationMs / 1000));
+    m_controller->startCalibration(kCalibrationDurationMs);
+}
+
+void MainWindow::handleCalibrationFinished(const QVector<DeviceCalibration> &calibrations)
+{
+    if (!calibrations.isEmpty()) {
+        mergeCalibrations(m_config.calibrations, calibrations);
+        saveSettings();
+    }
+
+    // The window may have been closed to the tray while the calibration ran.
+    if (!m_calibrationLabel) {
+        return;
+    }
+    m_calibrateButton->setEnabled(true);
+    if (calibrations.isEmpty()) {
+        m_calibrationLabel->setText(QStringLiteral("Калібрування: замало подій руху, спробуйте ще раз."));
+        return;
+    }
+
+    QStringList lines;
+    for (const DeviceCalibration &calibration : calibrations) {
+        lines.append(QStringLiteral("%1: %2 Гц, поріг %3, відпускання %4 мс")
+                         .arg(calibration.name)
+                         .arg(calibration.result.reportRateHz, 0, 'f', 0)
+                         .arg(calibration.result.motionThreshold, 0, 'f', 3)
+                         .arg(calibration.result.idleReleaseMs));
+    }
+    m_calibrationLabel->setText(QStringLiteral("Калібрування збережено:\n%1").arg(lines.join(QLatin1Char('\n'))));
+}
+
 void MainWindow::presentError(const QString &message)
 {
     updateStatusLabel(message);
+    if (m_trayIcon && !isVisible()) {
+        m_trayIcon->showMessage(QStringLiteral("Помилка"), message, QSystemTrayIcon::Critical);
+        return;
+    }
     QMessageBox::critical(this, QStringLiteral("Помилка"), message);
 }
 
-void MainWindow::showAccessPrompt(const QString &devicePath)
+void MainWindow::showAccessPrompt(const QStringList &devicePaths)
 {
     if (!m_controller) {
         return;
     }
 
-    QMessageBox box(this);
-    box.setIcon(QMessageBox::Question);
-    box.setWindowTitle(QStringLiteral("Потрібні права доступу"));
-    box.setText(QStringLiteral("Програмі потрібен тимчасовий доступ до %1.").arg(devicePath));
-    box.setInformativeText(QStringLiteral("Натисніть \"Надати доступ\", щоб відкрити полкіт-підтвердження та додати ACL для вашого користувача."));
-    QPushButton *grantButton = box.addButton(QStringLiteral("Надати доступ"), QMessageBox::AcceptRole);
-    box.addButton(QMessageBox::Cancel);
-    box.setDefaultButton(grantButton);
-    box.exec();
-
-    if (box.clickedButton() == grantButton) {
-        const bool success = grantAccessWithPkexec(devicePath);
-        m_controller->deliverAccessConfirmation(success);
-        if (success) {
-            updateStatusLabel(QStringLiteral("Доступ надано. Повторюємо підключення..."));
+    // Non-modal: the GUI keeps running (and the controller keeps using the nodes it could
+    // open) while the question is on screen.
+    auto *box = new QMessageBox(this);
+    box->setAttribute(Qt::WA_DeleteOnClose);
+    box->setIcon(QMessageBox::Question);
+    box->setWindowTitle(QStringLiteral("Потрібні права доступу"));
+    box->setText(devicePaths.size() == 1
+                     ? QStringLiteral("Програмі потрібен тимчасовий доступ до %1.").arg(devicePaths.first())
+                     : QStringLiteral("Програмі потрібен тимчасовий доступ до %1 пристроїв.").arg(devicePaths.size()));
+    box->setInformativeText(QStringLiteral("Натисніть \"Надати доступ\", щоб одним полкіт-підтвердженням додати ACL для вашого користувача. Доступні пристрої вже працюють."));
+    box->setDetailedText(devicePaths.join(QLatin1Char('\n')));
+    QPushButton *grantButton = box->addButton(QStringLiteral("Надати доступ"), QMessageBox::AcceptRole);
+    box->addButton(QMessageBox::Cancel);
+    box->setDefaultButton(grantButton);
+    connect(box, &QMessageBox::finished, this, [this, box, grantButton, devicePaths]() {
+        if (box->clickedButton() == grantButton) {
+            grantAccessWithPkexec(devicePaths);
+        } else {
+            finishAccessGrant(false);
+        }
+    });
+    box->open();
+}
+
+void MainWindow::finishAccessGrant(bool granted)
+{
+    if (m_controller) {
+        m_controller->deliverAccessConfirmation(granted);
+    }
+    updateStatusLabel(granted ? QStringLiteral("Доступ надано. Повторюємо підключення...") : QStringLiteral("Доступ не було надано."));
+}
+
+void MainWindow::showWarning(const QString &title, const QString &message)
+{
+    auto *box = new QMessageBox(QMessageBox::Warning, title, message, QMessageBox::Ok, this);
+    box->setAttribute(Qt::WA_DeleteOnClose);
+    box->open();
+}
+
+void MainWindow::updateRealtimeLabel(const QString &scheduling, const QString &affinity, const QString &memoryLock, const QString &timerSlack)
+{
+    m_realtimeText = QStringLiteral("%1\n%2\n%3\n%4").arg(scheduling, affinity, memoryLock, timerSlack);
+    if (m_realtimeLabel) {
+        m_realtimeLabel->setText(m_realtimeText);
+    }
+}
+
+void MainWindow::updateDeviceInventory(const DeviceInventory &inventory)
+{
+    m_inventory = inventory;
+    showDeviceInventory();
+}
+
+void MainWindow::showDeviceInventory()
+{
+    if (!m_inventoryLabel) {
+        return;
+    }
+
+    QString pointerName;
+    QString keyboardName;
+    QStringList lines;
+    for (const DeviceInventoryEntry &entry : std::as_const(m_inventory)) {
+        if (entry.activePointer) {
+            pointerName = entry.descriptor;
+        }
+        if (entry.activeKeyboard) {
+            keyboardName = entry.descriptor;
         }
-        if (!success) {
-            updateStatusLabel(QStringLiteral("Доступ не було надано."));
+        if (!entry.pointer && !entry.keyboard) {
+            continue;
+        }
+
+        QStringList roles;
+        if (entry.pointer) {
+            roles.append(entry.activePointer ? QStringLiteral("миша, активна")
+                                             : entry.pointerAllowed ? QStringLiteral("миша")
+                                                                    : QStringLiteral("миша, відфільтровано"));
         }
-    } else {
-        m_controller->deliverAccessConfirmation(false);
-        updateStatusLabel(QStringLiteral("Доступ не було надано."));
+        if (entry.keyboard) {
+            roles.append(entry.activeKeyboard ? QStringLiteral("клавіатура, активна")
+                                              : entry.keyboardAllowed ? QStringLiteral("клавіатура")
+                                                                      : QStringLiteral("клавіатура, відфільтровано"));
+        }
+        lines.append(QStringLiteral("#%1 %2 — %3").arg(entry.id).arg(entry.descriptor, roles.join(QStringLiteral("; "))));
+    }
+
+    m_inventoryLabel->setText(lines.isEmpty() ? QStringLiteral("Пристроїв введення не знайдено") : lines.join(QLatin1Char('\n')));
+
+    const QString pointerText = pointerName.isEmpty()
+        ? QStringLiteral("Миша/тачпад: не знайдено")
+        : QStringLiteral("Миша/тачпад: %1").arg(pointerName);
+    m_pointerDeviceLabel->setText(pointerText);
+    const QString keyboardText = keyboardName.isEmpty()
+        ? QStringLiteral("Клавіатура: не знайдено")
+        : QStringLiteral("Клавіатура: %1").arg(keyboardName);
+    m_keyboardDeviceLabel->setText(keyboardText);
+}
+
+void MainWindow::handleCachedDevicesChanged(const CachedDevice &pointer, const CachedDevice &keyboard)
+{
+    if (updateDeviceCache(m_config, pointer, keyboard)) {
+        saveSettings();
     }
 }
 
-void MainWindow::updateDeviceLabels(const QString &pointerName, const QString &keyboardName)
+void MainWindow::ensureInterface()
 {
-    if (m_pointerDeviceLabel) {
-        const QString pointerText = pointerName.isEmpty()
-            ? QStringLiteral("Миша/тачпад: не знайдено")
-            : QStringLiteral("Миша/тачпад: %1").arg(pointerName);
-        m_pointerDeviceLabel->setText(pointerText);
+    if (m_cardFrame) {
+        return;
+    }
+
+    const quint32 activationKey = m_config.activationKey;
+    m_isRestoring = true;
+    buildInterface();
+    populateKeyOptions();
+    syncWidgetsFromConfig();
+    m_isRestoring = false;
+    if (m_config.activationKey != activationKey) {
+        handleActivationChanged(m_activationCombo->currentIndex());
+    }
+    updateRandomizerWidgets();
+    applyTheme(m_currentTheme);
+
+    if (!m_inventory.isEmpty()) {
+        showDeviceInventory();
     }
-    if (m_keyboardDeviceLabel) {
-        const QString keyboardText = keyboardName.isEmpty()
-            ? QStringLiteral("Клавіатура: не знайдено")
-            : QStringLiteral("Клавіатура: %1").arg(keyboardName);
-        m_keyboardDeviceLabel->setText(keyboardText);
+    if (!m_realtimeText.isEmpty()) {
+        m_realtimeLabel->setText(m_realtimeText);
     }
+    m_lastStatusVersion = 0;
+}
+
+// Everything below the window frame goes, stylesheet included; the controller, settings and
+// the tray icon stay. Runs from the event loop so a hide that turns out to be a minimize
+// (the window stays visible) keeps its widgets.
+void MainWindow::teardownInterface()
+{
+    if (!m_cardFrame || isVisible()) {
+        return;
+    }
+
+    m_controller->setTelemetryEnabled(false);
+    delete takeCentralWidget();
+    m_cardFrame = nullptr;
+    m_activationCombo = nullptr;
+    m_randomizerCheck = nullptr;
+    m_minSlider = nullptr;
+    m_maxSlider = nullptr;
+    m_minLabel = nullptr;
+    m_maxLabel = nullptr;
+    m_statusLabel = nullptr;
+    m_themeCombo = nullptr;
+    m_pointerDeviceLabel = nullptr;
+    m_keyboardDeviceLabel = nullptr;
+    m_inventoryLabel = nullptr;
+    m_latencyLabel = nullptr;
+    m_realtimeLabel = nullptr;
+    m_wakeupsLabel = nullptr;
+    m_countersLabel = nullptr;
+    m_calibrationLabel = nullptr;
+    m_calibrateButton = nullptr;
+    m_telemetryGraph = nullptr;
+    m_keyOptions.clear();
+    m_keyOptions.squeeze();
+    qApp->setStyleSheet(QString());
+
+#ifdef __GLIBC__
+    // Hand the freed widget heap back to the kernel instead of keeping it for a window
+    // that may not be opened again this session. With Realtime/LockMemory the controller
+    // has turned trimming off so locked pages are never given back and faulted in again;
+    // trimming here would undo that, so the heap is kept.
+    if (!m_config.realtime.lockMemory) {
+        malloc_trim(0);
+    }
+#endif
 }
 
 void MainWindow::buildInterface()
@@ -277,6 +686,61 @@ void MainWindow::buildInterface()
     m_keyboardDeviceLabel->setWordWrap(true);
     cardLayout->addWidget(m_keyboardDeviceLabel);
 
+    m_inventoryLabel = new QLabel(m_cardFrame);
+    m_inventoryLabel->setObjectName(QStringLiteral("deviceValue"));
+    m_inventoryLabel->setWordWrap(true);
+    cardLayout->addWidget(m_inventoryLabel);
+
+    auto *diagnosticsHeader = new QLabel(QStringLiteral("Діагностика"), m_cardFrame);
+    diagnosticsHeader->setObjectName(QStringLiteral("devicesTitle"));
+    cardLayout->addWidget(diagnosticsHeader);
+
+    m_latencyLabel = new QLabel(QStringLiteral("Затримка подія → uinput: ще немає вимірювань"), m_cardFrame);
+    m_latencyLabel->setObjectName(QStringLiteral("deviceValue"));
+    m_latencyLabel->setWordWrap(true);
+    cardLayout->addWidget(m_latencyLabel);
+
+    m_realtimeLabel = new QLabel(QStringLiteral("Режим реального часу: очікування запуску контролера..."), m_cardFrame);
+    m_realtimeLabel->setObjectName(QStringLiteral("deviceValue"));
+    m_realtimeLabel->setWordWrap(true);
+    cardLayout->addWidget(m_realtimeLabel);
+
+    m_wakeupsLabel = new QLabel(QStringLiteral("Пробуджень контролера за секунду: вимірювання..."), m_cardFrame);
+    m_wakeupsLabel->setObjectName(QStringLiteral("deviceValue"));
+    cardLayout->addWidget(m_wakeupsLabel);
+
+    m_countersLabel = new QLabel(m_cardFrame);
+    m_countersLabel->setObjectName(QStringLiteral("deviceValue"));
+    m_countersLabel->setWordWrap(true);
+    cardLayout->addWidget(m_countersLabel);
+
+    m_calibrationLabel = new QLabel(m_cardFrame);
+    m_calibrationLabel->setObjectName(QStringLiteral("deviceValue"));
+    m_calibrationLabel->setWordWrap(true);
+    cardLayout->addWidget(m_calibrationLabel);
+
+    auto *graphCheck = new QCheckBox(QStringLiteral("Графік руху (dx, поріг, клавіша)"), m_cardFrame);
+    cardLayout->addWidget(graphCheck);
+
+    m_telemetryGraph = new TelemetryGraph(m_controller, m_cardFrame);
+    m_telemetryGraph->setMinimumHeight(140);
+    m_telemetryGraph->setVisible(false);
+    cardLayout->addWidget(m_telemetryGraph);
+    connect(graphCheck, &QCheckBox::toggled, m_telemetryGraph, &QWidget::setVisible);
+
+    auto *diagnosticsButtons = new QHBoxLayout();
+    auto *resetLatencyButton = new QPushButton(QStringLiteral("Скинути"), m_cardFrame);
+    auto *exportLatencyButton = new QPushButton(QStringLiteral("Експортувати..."), m_cardFrame);
+    auto *exportCountersButton = new QPushButton(QStringLiteral("Лічильники JSON..."), m_cardFrame);
+    m_calibrateButton = new QPushButton(QStringLiteral("Калібрувати"), m_cardFrame);
+    m_calibrateButton->setToolTip(QStringLiteral("Виміряти частоту опитування миші та підібрати поріг руху й інтервал відпускання"));
+    diagnosticsButtons->addWidget(resetLatencyButton);
+    diagnosticsButtons->addWidget(exportLatencyButton);
+    diagnosticsButtons->addWidget(exportCountersButton);
+    diagnosticsButtons->addWidget(m_calibrateButton);
+    diagnosticsButtons->addStretch(1);
+    cardLayout->addLayout(diagnosticsButtons);
+
     m_statusLabel = new QLabel(QStringLiteral("Статус: ініціалізація..."), m_cardFrame);
     m_statusLabel->setObjectName(QStringLiteral("statusLabel"));
     m_statusLabel->setWordWrap(true);
@@ -287,21 +751,29 @@ void MainWindow::buildInterface()
     outerLayout->addWidget(m_cardFrame);
     outerLayout->addStretch(1);
 
+    // Initial values go in before the handlers are connected, so building the window does not
+    // push config to the controller or queue a save.
+    m_minSlider->setValue(m_config.randomizerMinimum);
+    m_maxSlider->setValue(m_config.randomizerMaximum);
+    m_randomizerCheck->setChecked(false);
+    m_themeCombo->setCurrentIndex(m_currentTheme == Theme::Dark ? 0 : 1);
+
     connect(m_activationCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::handleActivationChanged);
     connect(m_randomizerCheck, &QCheckBox::toggled, this, &MainWindow::handleRandomizerToggled);
     connect(m_minSlider, &QSlider::valueChanged, this, &MainWindow::handleMinRangeChanged);
     connect(m_maxSlider, &QSlider::valueChanged, this, &MainWindow::handleMaxRangeChanged);
     connect(m_themeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::handleThemeChanged);
-
-    m_minSlider->setValue(m_minSync);
-    m_maxSlider->setValue(m_maxSync);
-    m_randomizerCheck->setChecked(false);
-    m_themeCombo->setCurrentIndex(m_currentTheme == Theme::Dark ? 0 : 1);
+    connect(resetLatencyButton, &QPushButton::clicked, m_controller, &InputController::resetLatencyStatistics);
+    connect(exportLatencyButton, &QPushButton::clicked, this, &MainWindow::exportLatencyHistogram);
+    connect(exportCountersButton, &QPushButton::clicked, this, &MainWindow::exportRuntimeCounters);
+    connect(m_calibrateButton, &QPushButton::clicked, this, &MainWindow::startCalibration);
 }
 
 void MainWindow::populateKeyOptions()
 {
     m_keyOptions.clear();
+    // The first addItem() selects it; syncWidgetsFromConfig() picks the real key afterwards.
+    m_activationCombo->blockSignals(true);
     m_activationCombo->clear();
 
     const auto appendOption = [this](const QString &label, quint32 keycode) {
@@ -335,11 +807,16 @@ void MainWindow::populateKeyOptions()
     for (int i = 1; i <= 12; ++i) {
         appendOption(QStringLiteral("F%1").arg(i), static_cast<quint32>(KEY_F1 + (i - 1)));
     }
+    m_activationCombo->blockSignals(false);
 }
 
 void MainWindow::applyTheme(Theme theme)
 {
     m_currentTheme = theme;
+    // Without widgets there is nothing to style; ensureInterface() applies it later.
+    if (!m_cardFrame) {
+        return;
+    }
 
     const bool dark = (theme == Theme::Dark);
     const QString background = dark ? QStringLiteral("#101014") : QStringLiteral("#f5f7fb");
@@ -397,95 +874,75 @@ void MainWindow::applyTheme(Theme theme)
 
 void MainWindow::refreshRandomizerControls()
 {
-    const bool enabled = m_randomizerCheck->isChecked();
+    updateRandomizerWidgets();
+    m_controller->setRandomizerEnabled(m_config.randomizerEnabled);
+    syncRangeWithController();
+}
+
+void MainWindow::updateRandomizerWidgets()
+{
+    if (!m_randomizerCheck) {
+        return;
+    }
+
+    const bool enabled = m_config.randomizerEnabled;
     m_minSlider->setEnabled(enabled);
     m_maxSlider->setEnabled(enabled);
     m_minLabel->setEnabled(enabled);
     m_maxLabel->setEnabled(enabled);
-
-    m_controller->setRandomizerEnabled(enabled);
-    syncRangeWithController();
 }
 
 void MainWindow::syncRangeWithController()
 {
-    if (!m_randomizerCheck->isChecked()) {
+    if (!m_config.randomizerEnabled) {
         m_controller->setRandomizerRange(100, 100);
         return;
     }
 
-    m_controller->setRandomizerRange(m_minSync, m_maxSync);
+    m_controller->setRandomizerRange(m_config.randomizerMinimum, m_config.randomizerMaximum);
 }
 
 void MainWindow::updateRangeLabels()
 {
     if (m_minLabel) {
-        m_minLabel->setText(formatPercentLabel(QStringLiteral("Мінімальна синхронізація"), m_minSync));
+        m_minLabel->setText(formatPercentLabel(QStringLiteral("Мінімальна синхронізація"), m_config.randomizerMinimum));
     }
     if (m_maxLabel) {
-        m_maxLabel->setText(formatPercentLabel(QStringLiteral("Максимальна синхронізація"), m_maxSync));
+        m_maxLabel->setText(formatPercentLabel(QStringLiteral("Максимальна синхронізація"), m_config.randomizerMaximum));
     }
 }
 
 void MainWindow::loadSettings()
 {
-    if (!m_settings) {
-        return;
-    }
-
-    m_initialActivationKey = m_settings->value(QStringLiteral("Input/ActivationKey"), static_cast<quint32>(KEY_LEFTSHIFT)).toUInt();
-    m_randomizerInitiallyEnabled = m_settings->value(QStringLiteral("Randomizer/Enabled"), false).toBool();
-    m_minSync = std::clamp(m_settings->value(QStringLiteral("Randomizer/Minimum"), 70).toInt(), 0, 100);
-    m_maxSync = std::clamp(m_settings->value(QStringLiteral("Randomizer/Maximum"), 90).toInt(), 0, 100);
-    if (m_maxSync < m_minSync) {
-        std::swap(m_maxSync, m_minSync);
-    }
-
-    const QString themeValue = m_settings->value(QStringLiteral("Appearance/Theme"), QStringLiteral("Dark")).toString();
-    m_currentTheme = (themeValue.compare(QStringLiteral("Light"), Qt::CaseInsensitive) == 0) ? Theme::Light : Theme::Dark;
-
-    m_pointerAllowedBrands = readBrandList(QStringLiteral("Devices/PointerAllow"), defaultPointerBrands());
-    m_pointerBlockedBrands = readBrandList(QStringLiteral("Devices/PointerBlock"), defaultBlockedBrands());
-    m_keyboardAllowedBrands = readBrandList(QStringLiteral("Devices/KeyboardAllow"), defaultKeyboardBrands());
-    m_keyboardBlockedBrands = readBrandList(QStringLiteral("Devices/KeyboardBlock"), defaultBlockedBrands());
-
-    const auto ensureBinder = [](QStringList &list) {
-        for (const QString &entry : list) {
-            if (entry.compare(QStringLiteral("MouseDirectionBinder"), Qt::CaseInsensitive) == 0) {
-                return;
-            }
-        }
-        list.append(QStringLiteral("MouseDirectionBinder"));
-    };
-    ensureBinder(m_pointerBlockedBrands);
-    ensureBinder(m_keyboardBlockedBrands);
+    m_config = m_settingsStore.load();
+    m_currentTheme = (m_config.theme.compare(QStringLiteral("Light"), Qt::CaseInsensitive) == 0) ? Theme::Light : Theme::Dark;
+}
 
-    if (!m_settings->contains(QStringLiteral("Devices/PointerAllow"))) {
-        writeBrandList(QStringLiteral("Devices/PointerAllow"), m_pointerAllowedBrands);
-    }
-    if (!m_settings->contains(QStringLiteral("Devices/PointerBlock"))) {
-        writeBrandList(QStringLiteral("Devices/PointerBlock"), m_pointerBlockedBrands);
-    }
-    if (!m_settings->contains(QStringLiteral("Devices/KeyboardAllow"))) {
-        writeBrandList(QStringLiteral("Devices/KeyboardAllow"), m_keyboardAllowedBrands);
-    }
-    if (!m_settings->contains(QStringLiteral("Devices/KeyboardBlock"))) {
-        writeBrandList(QStringLiteral("Devices/KeyboardBlock"), m_keyboardBlockedBrands);
+void MainWindow::reloadSettings()
+{
+    // A pending write of ours would overwrite the edit anyway, and the event that follows
+    // our own write would only read back what we already have.
+    if (m_settingsSaver.isPending() || m_settingsSaver.isLastWrite()) {
+        return;
     }
 
-    m_settings->sync();
+    loadSettings();
+    m_isRestoring = true;
+    syncWidgetsFromConfig();
+    updateRandomizerWidgets();
+    applyTheme(m_currentTheme);
+    m_isRestoring = false;
+    applyLiveSettings(*m_controller, m_config);
 }
 
-void MainWindow::restoreSettings()
+void MainWindow::syncWidgetsFromConfig()
 {
-    m_isRestoring = true;
-
     if (m_activationCombo) {
         m_activationCombo->blockSignals(true);
-        int index = m_activationCombo->findData(m_initialActivationKey);
+        int index = m_activationCombo->findData(m_config.activationKey);
         if (index < 0 && m_activationCombo->count() > 0) {
             index = 0;
-            m_initialActivationKey = m_activationCombo->itemData(index).toUInt();
+            m_config.activationKey = m_activationCombo->itemData(index).toUInt();
         }
         if (index >= 0) {
             m_activationCombo->setCurrentIndex(index);
@@ -495,18 +952,18 @@ void MainWindow::restoreSettings()
 
     if (m_randomizerCheck) {
         m_randomizerCheck->blockSignals(true);
-        m_randomizerCheck->setChecked(m_randomizerInitiallyEnabled);
+        m_randomizerCheck->setChecked(m_config.randomizerEnabled);
         m_randomizerCheck->blockSignals(false);
     }
 
     if (m_minSlider) {
         m_minSlider->blockSignals(true);
-        m_minSlider->setValue(m_minSync);
+        m_minSlider->setValue(m_config.randomizerMinimum);
         m_minSlider->blockSignals(false);
     }
     if (m_maxSlider) {
         m_maxSlider->blockSignals(true);
-        m_maxSlider->setValue(m_maxSync);
+        m_maxSlider->setValue(m_config.randomizerMaximum);
         m_maxSlider->blockSignals(false);
     }
 
@@ -516,142 +973,47 @@ void MainWindow::restoreSettings()
         m_themeCombo->blockSignals(false);
     }
 
-    updateRangeLabels();
-
-    m_isRestoring = false;
-
-    if (m_activationCombo && m_activationCombo->count() > 0) {
-        handleActivationChanged(m_activationCombo->currentIndex());
+    if (m_telemetryGraph) {
+        m_telemetryGraph->setKeyMap(activeKeyMap(m_config));
     }
 
-    refreshRandomizerControls();
-    applyTheme(m_currentTheme);
-    saveSettings();
+    updateRangeLabels();
 }
 
 void MainWindow::saveSettings()
 {
-    if (!m_settings || m_isRestoring) {
-        return;
-    }
-
-    m_settings->setValue(QStringLiteral("Input/ActivationKey"), static_cast<quint32>(m_initialActivationKey));
-    m_settings->setValue(QStringLiteral("Randomizer/Enabled"), m_randomizerInitiallyEnabled);
-    m_settings->setValue(QStringLiteral("Randomizer/Minimum"), m_minSync);
-    m_settings->setValue(QStringLiteral("Randomizer/Maximum"), m_maxSync);
-    const QString themeValue = (m_currentTheme == Theme::Dark) ? QStringLiteral("Dark") : QStringLiteral("Light");
-    m_settings->setValue(QStringLiteral("Appearance/Theme"), themeValue);
-    writeBrandList(QStringLiteral("Devices/PointerAllow"), m_pointerAllowedBrands);
-    writeBrandList(QStringLiteral("Devices/PointerBlock"), m_pointerBlockedBrands);
-    writeBrandList(QStringLiteral("Devices/KeyboardAllow"), m_keyboardAllowedBrands);
-    writeBrandList(QStringLiteral("Devices/KeyboardBlock"), m_keyboardBlockedBrands);
-    m_settings->sync();
-}
-
-QString MainWindow::configFilePath() const
-{
-    const QString home = QDir::homePath();
-    QDir configDir(home + QStringLiteral("/.config"));
-    return configDir.filePath(QStringLiteral("Mouse→A_D Helper.ini"));
-}
-
-QStringList MainWindow::defaultPointerBrands() const
-{
-    return {
-        QStringLiteral("Logitech"), QStringLiteral("SteelSeries"), QStringLiteral("Razer"),
-        QStringLiteral("ASUS"), QStringLiteral("Synaptics"), QStringLiteral("ELAN"),
-        QStringLiteral("Apple"), QStringLiteral("Microsoft"), QStringLiteral("Lenovo"),
-        QStringLiteral("HP"), QStringLiteral("Dell"), QStringLiteral("Glorious"),
-        QStringLiteral("Zowie"), QStringLiteral("Touchpad"), QStringLiteral("Mouse")
-    };
-}
-
-QStringList MainWindow::defaultKeyboardBrands() const
-{
-    return {
-        QStringLiteral("Logitech"), QStringLiteral("SteelSeries"), QStringLiteral("Razer"),
-        QStringLiteral("ASUS"), QStringLiteral("Corsair"), QStringLiteral("MSI"),
-        QStringLiteral("Keychron"), QStringLiteral("Anne"), QStringLiteral("Ducky"),
-        QStringLiteral("Vortex"), QStringLiteral("Apple"), QStringLiteral("Lenovo"),
-        QStringLiteral("Dell"), QStringLiteral("Keyboard")
-    };
-}
-
-QStringList MainWindow::defaultBlockedBrands() const
-{
-    return {
-        QStringLiteral("Virtual"), QStringLiteral("uinput"), QStringLiteral("seat"),
-        QStringLiteral("test"), QStringLiteral("dummy"), QStringLiteral("MouseDirectionBinder")
-    };
-}
-
-QStringList MainWindow::readBrandList(const QString &key, const QStringList &fallback) const
-{
-    if (!m_settings) {
-        return fallback;
-    }
-
-    const QString raw = m_settings->value(key).toString();
-    if (raw.trimmed().isEmpty()) {
-        return fallback;
-    }
-
-    QStringList parsed = parseBrandString(raw);
-    if (parsed.isEmpty()) {
-        return fallback;
-    }
-    return parsed;
-}
-
-void MainWindow::writeBrandList(const QString &key, const QStringList &values)
-{
-    if (!m_settings) {
+    if (m_isRestoring) {
         return;
     }
-    m_settings->setValue(key, brandsToString(values));
-}
 
-QStringList MainWindow::parseBrandString(const QString &value) const
-{
-    QString normalised = value;
-    normalised.replace(QLatin1Char(';'), QLatin1Char(','));
-    QStringList parts = normalised.split(QLatin1Char(','), Qt::SkipEmptyParts);
-    QStringList result;
-    result.reserve(parts.size());
-    for (QString part : parts) {
-        part = part.trimmed();
-        if (!part.isEmpty() && !result.contains(part, Qt::CaseInsensitive)) {
-            result.append(part);
-        }
-    }
-    return result;
+    m_config.theme = (m_currentTheme == Theme::Dark) ? QStringLiteral("Dark") : QStringLiteral("Light");
+    m_settingsSaver.schedule(m_config);
 }
 
-QString MainWindow::brandsToString(const QStringList &values) const
+QString MainWindow::keyLabel(quint32 keycode) const
 {
-    QStringList cleaned;
-    cleaned.reserve(values.size());
-    for (QString value : values) {
-        value = value.trimmed();
-        if (!value.isEmpty() && !cleaned.contains(value, Qt::CaseInsensitive)) {
-            cleaned.append(value);
+    for (const KeyOption &option : m_keyOptions) {
+        if (option.keycode == keycode) {
+            return option.label;
         }
     }
-    return cleaned.join(QStringLiteral(", "));
+    return QString::number(keycode);
 }
 
-bool MainWindow::grantAccessWithPkexec(const QString &devicePath)
+void MainWindow::grantAccessWithPkexec(const QStringList &devicePaths)
 {
     const QString pkexecPath = QStandardPaths::findExecutable(QStringLiteral("pkexec"));
     if (pkexecPath.isEmpty()) {
-        QMessageBox::warning(this, QStringLiteral("pkexec не знайдено"), QStringLiteral("Не вдалося знайти утиліту pkexec. Встановіть polkit і повторіть спробу."));
-        return false;
+        showWarning(QStringLiteral("pkexec не знайдено"), QStringLiteral("Не вдалося знайти утиліту pkexec. Встановіть polkit і повторіть спробу."));
+        finishAccessGrant(false);
+        return;
     }
 
     const QString setfaclPath = QStandardPaths::findExecutable(QStringLiteral("setfacl"));
     if (setfaclPath.isEmpty()) {
-        QMessageBox::warning(this, QStringLiteral("setfacl не знайдено"), QStringLiteral("Не вдалося знайти утиліту setfacl. Встановіть пакет acl."));
-        return false;
+        showWarning(QStringLiteral("setfacl не знайдено"), QStringLiteral("Не вдалося знайти утиліту setfacl. Встановіть пакет acl."));
+        finishAccessGrant(false);
+        return;
     }
 
     QString user = QString::fromLocal8Bit(qgetenv("USER"));
@@ -662,32 +1024,39 @@ bool MainWindow::grantAccessWithPkexec(const QString &devicePath)
         user = QString::fromLocal8Bit(qgetenv("LOGNAME"));
     }
     if (user.isEmpty()) {
-        QMessageBox::warning(this, QStringLiteral("Невідомий користувач"), QStringLiteral("Не вдалося визначити ім'я користувача для призначення прав доступу."));
-        return false;
+        showWarning(QStringLiteral("Невідомий користувач"), QStringLiteral("Не вдалося визначити ім'я користувача для призначення прав доступу."));
+        finishAccessGrant(false);
+        return;
     }
 
-    QProcess process;
     QStringList arguments;
     arguments << setfaclPath
               << QStringLiteral("-m")
               << QStringLiteral("u:%1:rw").arg(user)
-              << devicePath;
-
-    process.start(pkexecPath, arguments);
-    if (!process.waitForStarted()) {
-        QMessageBox::warning(this, QStringLiteral("Не вдалося запустити pkexec"), QStringLiteral("Процес pkexec не стартував."));
-        return false;
-    }
-
-    process.waitForFinished(-1);
-    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
-        const QString errorOutput = QString::fromLocal8Bit(process.readAllStandardError());
-        QMessageBox::warning(this, QStringLiteral("Доступ не надано"),
-                             errorOutput.isEmpty()
-                                 ? QStringLiteral("Користувач скасував операцію або доступ не було надано.")
-                                 : errorOutput);
-        return false;
-    }
-
-    return true;
+              << devicePaths;
+
+    // pkexec stays up for as long as the polkit dialog is open; only its exit is waited
+    // for, through the event loop.
+    auto *process = new QProcess(this);
+    connect(process, &QProcess::errorOccurred, this, [this, process](QProcess::ProcessError error) {
+        if (error != QProcess::FailedToStart) {
+            return;
+        }
+        showWarning(QStringLiteral("Не вдалося запустити pkexec"), QStringLiteral("Процес pkexec не стартував."));
+        finishAccessGrant(false);
+        process->deleteLater();
+    });
+    connect(process, &QProcess::finished, this, [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
+        const bool granted = (exitStatus == QProcess::NormalExit && exitCode == 0);
+        if (!granted) {
+            const QString errorOutput = QString::fromLocal8Bit(process->readAllStandardError());
+            showWarning(QStringLiteral("Доступ не надано"),
+                        errorOutput.isEmpty()
+                            ? QStringLiteral("Користувач скасував операцію або доступ не було надано.")
+                            : errorOutput);
+        }
+        finishAccessGrant(granted);
+        process->deleteLater();
+    });
+    process->start(pkexecPath, arguments);
 }
@@ -1,24 +1,33 @@
 #pragma once
 
+#include "appsettings.h"
+#include "deviceinventory.h"
+#include "motioncalibrator.h"
+#include "settingssaver.h"
+
+#include <QElapsedTimer>
 #include <QMainWindow>
 #include <QVector>
 #include <QString>
 #include <QStringList>
 
-#include <linux/input-event-codes.h>
-
-class QSettings;
-
 QT_BEGIN_NAMESPACE
 class QCheckBox;
 class QCloseEvent;
+class QHideEvent;
+class QShowEvent;
 class QComboBox;
 class QLabel;
+class QPushButton;
 class QSlider;
+class QSystemTrayIcon;
 class QFrame;
+class QTimer;
 QT_END_NAMESPACE
 
+class ConfigWatcher;
 class InputController;
+class TelemetryGraph;
 
 class MainWindow : public QMainWindow
 {
@@ -27,7 +36,17 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow() override;
 
+    // Puts an icon in the system tray and keeps the process running while the window is
+    // closed; the widgets are destroyed on every hide and rebuilt by openWindow(). Returns
+    // false, changing nothing, when there is no system tray.
+    bool enableTrayMode();
+
+public slots:
+    void openWindow();
+
 protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
     void closeEvent(QCloseEvent *event) override;
 
 private slots:
@@ -37,9 +56,18 @@ private slots:
     void handleMaxRangeChanged(int value);
     void handleThemeChanged(int index);
     void updateStatusLabel(const QString &statusText);
+    void refreshControllerStatus();
+    void refreshDiagnostics();
+    void exportLatencyHistogram();
+    void exportRuntimeCounters();
+    void startCalibration();
+    void handleCalibrationFinished(const QVector<DeviceCalibration> &calibrations);
     void presentError(const QString &message);
-    void showAccessPrompt(const QString &devicePath);
-    void updateDeviceLabels(const QString &pointerName, const QString &keyboardName);
+    void showAccessPrompt(const QStringList &devicePaths);
+    void updateDeviceInventory(const DeviceInventory &inventory);
+    void handleCachedDevicesChanged(const CachedDevice &pointer, const CachedDevice &keyboard);
+    void updateRealtimeLabel(const QString &scheduling, const QString &affinity, const QString &memoryLock, const QString &timerSlack);
+    void reloadSettings();
 
 private:
     enum class Theme {
@@ -52,27 +80,32 @@ private:
         quint32 keycode;
     };
 
+    void ensureInterface();
+    void teardownInterface();
     void buildInterface();
     void populateKeyOptions();
     void applyTheme(Theme theme);
     void refreshRandomizerControls();
+    void updateRandomizerWidgets();
     void syncRangeWithController();
     void updateRangeLabels();
     void loadSettings();
-    void restoreSettings();
+    void syncWidgetsFromConfig();
     void saveSettings();
-    QString configFilePath() const;
-    QStringList defaultPointerBrands() const;
-    QStringList defaultKeyboardBrands() const;
-    QStringList defaultBlockedBrands() const;
-    QStringList readBrandList(const QString &key, const QStringList &fallback) const;
-    void writeBrandList(const QString &key, const QStringList &values);
-    QStringList parseBrandString(const QString &value) const;
-    QString brandsToString(const QStringList &values) const;
-    bool grantAccessWithPkexec(const QString &devicePath);
+    QString keyLabel(quint32 keycode) const;
+    void showDeviceInventory();
+    // Answers the controller from QProcess signals once pkexec exits.
+    void grantAccessWithPkexec(const QStringList &devicePaths);
+    void finishAccessGrant(bool granted);
+    void showWarning(const QString &title, const QString &message);
 
     InputController *m_controller{nullptr};
     QVector<KeyOption> m_keyOptions;
+    QTimer *m_statusTimer{nullptr};
+    QTimer *m_diagnosticsTimer{nullptr};
+    quint64 m_lastStatusVersion{0};
+    QElapsedTimer m_wakeupClock;
+    quint64 m_lastWakeups{0};
 
     QFrame *m_cardFrame{nullptr};
     QComboBox *m_activationCombo{nullptr};
@@ -85,18 +118,24 @@ private:
     QComboBox *m_themeCombo{nullptr};
     QLabel *m_pointerDeviceLabel{nullptr};
     QLabel *m_keyboardDeviceLabel{nullptr};
+    QLabel *m_inventoryLabel{nullptr};
+    QLabel *m_latencyLabel{nullptr};
+    QLabel *m_realtimeLabel{nullptr};
+    QLabel *m_wakeupsLabel{nullptr};
+    QLabel *m_countersLabel{nullptr};
+    QLabel *m_calibrationLabel{nullptr};
+    QPushButton *m_calibrateButton{nullptr};
+    TelemetryGraph *m_telemetryGraph{nullptr};
+    QSystemTrayIcon *m_trayIcon{nullptr};
+
+    // Kept while the widgets are torn down, so a rebuilt window starts up to date.
+    DeviceInventory m_inventory;
+    QString m_realtimeText;
 
     Theme m_currentTheme{Theme::Dark};
-    int m_minSync{70};
-    int m_maxSync{90};
-    bool m_randomizerInitiallyEnabled{false};
-    quint32 m_initialActivationKey{KEY_LEFTSHIFT};
-
-    QSettings *m_settings{nullptr};
+    AppSettings m_config;
+    SettingsStore m_settingsStore;
+    SettingsSaver m_settingsSaver;
+    ConfigWatcher *m_configWatcher{nullptr};
     bool m_isRestoring{false};
-
-    QStringList m_pointerAllowedBrands;
-    QStringList m_pointerBlockedBrands;
-    QStringList m_keyboardAllowedBrands;
-    QStringList m_keyboardBlockedBrands;
 };
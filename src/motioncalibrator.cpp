@@ -0,0 +1,57 @@
+#include "motioncalibrator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+template<typename T>
+T percentile(std::vector<T> values, double fraction)
+{
+    const std::size_t index = std::min(values.size() - 1, static_cast<std::size_t>(fraction * static_cast<double>(values.size())));
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+    return values[index];
+}
+} // namespace
+
+MotionCalibrator::MotionCalibrator()
+{
+    m_intervals.reserve(kMaxSamples);
+    m_deltas.reserve(kMaxSamples);
+}
+
+void MotionCalibrator::addSample(uint64_t timeUsec, double deltaX, double rawDeltaX)
+{
+    const double magnitude = std::max(std::fabs(deltaX), std::fabs(rawDeltaX));
+    if (m_lastTimeUsec != 0 && timeUsec > m_lastTimeUsec && !isFull()) {
+        m_intervals.push_back(static_cast<uint32_t>(std::min<uint64_t>(timeUsec - m_lastTimeUsec, UINT32_MAX)));
+        if (magnitude > 0.0) {
+            m_deltas.push_back(static_cast<float>(magnitude));
+        }
+    }
+    m_lastTimeUsec = timeUsec;
+}
+
+bool MotionCalibrator::compute(CalibrationResult &result) const
+{
+    if (m_intervals.size() < kMinSamples || m_deltas.size() < kMinSamples) {
+        return false;
+    }
+
+    // The median interval is the polling period while the mouse is moving; pauses only
+    // show up in the tail and are what the idle-release interval has to ride over.
+    const uint32_t medianInterval = std::max<uint32_t>(1, percentile(m_intervals, 0.5));
+    const uint32_t tailInterval = std::max(medianInterval, percentile(m_intervals, 0.99));
+    const double medianDelta = percentile(m_deltas, 0.5);
+
+    result.samples = static_cast<uint32_t>(m_intervals.size());
+    result.reportRateHz = 1000000.0 / static_cast<double>(medianInterval);
+
+    const double rateScale = std::min(1.0, kBaseRateHz / result.reportRateHz);
+    result.motionThreshold = std::clamp(std::min(kBaseThreshold * rateScale, medianDelta * 0.5), kMinimumThreshold, kBaseThreshold);
+
+    const double idleMs = std::max(kBaseIdleReleaseMs * rateScale, static_cast<double>(tailInterval) * 50.0 / 1000.0);
+    result.idleReleaseMs = static_cast<uint32_t>(std::clamp(std::ceil(idleMs), static_cast<double>(kMinimumIdleReleaseMs),
+                                                            static_cast<double>(kBaseIdleReleaseMs)));
+    return true;
+}
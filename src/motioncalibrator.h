@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct CalibrationResult {
+    double reportRateHz{0.0};
+    double motionThreshold{0.0};
+    uint32_t idleReleaseMs{0};
+    uint32_t samples{0};
+};
+
+struct DeviceCalibration {
+    quint32 vendor{0};
+    quint32 product{0};
+    QString name;
+    CalibrationResult result;
+};
+
+// Collects report intervals and |dx| for one device and derives a motion threshold and
+// idle-release interval from them. The defaults (0.4, 150 ms) are tuned for 1 kHz mice;
+// faster devices get proportionally smaller values, bounded by what their deltas allow.
+class MotionCalibrator
+{
+public:
+    static constexpr std::size_t kMaxSamples = 16384;
+    static constexpr std::size_t kMinSamples = 64;
+    static constexpr double kBaseThreshold = 0.4;
+    static constexpr double kMinimumThreshold = 0.02;
+    static constexpr double kBaseRateHz = 1000.0;
+    static constexpr uint32_t kBaseIdleReleaseMs = 150;
+    static constexpr uint32_t kMinimumIdleReleaseMs = 30;
+
+    MotionCalibrator();
+
+    void addSample(uint64_t timeUsec, double deltaX, double rawDeltaX);
+    std::size_t sampleCount() const { return m_intervals.size(); }
+    bool isFull() const { return m_intervals.size() >= kMaxSamples; }
+
+    // Returns false when too few reports were seen to say anything useful.
+    bool compute(CalibrationResult &result) const;
+
+private:
+    std::vector<uint32_t> m_intervals;
+    std::vector<float> m_deltas;
+    uint64_t m_lastTimeUsec{0};
+};
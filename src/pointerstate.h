@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Everything the motion path reads or writes per pointer event, one cache line per pointer.
+// InputDevice keeps the names and filter results; a pointer reaches its line through
+// InputDevice::stateSlot.
+struct alignas(64) PointerState {
+    uint64_t lastTimeUsec{0};
+    // Motion accumulated since the start of the current dispatch when coalescing is on.
+    uint64_t pendingSinceUsec{0};
+    float pendingDx{0.0f};
+    float pendingDxUnaccelerated{0.0f};
+    float pendingDy{0.0f};
+    float pendingDyUnaccelerated{0.0f};
+    // Last absolute position in mm; absolute pointers report no deltas of their own.
+    float absoluteX{0.0f};
+    float absoluteY{0.0f};
+    double motionThreshold{0.4};
+    uint32_t idleReleaseMs{150};
+    uint16_t deviceId{0};
+    bool pending{false};
+    bool hasAbsolute{false};
+};
+
+static_assert(sizeof(PointerState) == 64, "PointerState must stay one cache line");
+
+// Flat table of PointerState lines indexed by a small slot number; all of it fits in L1.
+// Pointers beyond the capacity share kSharedSlot and so behave like one pointer.
+class PointerStateTable
+{
+public:
+    static constexpr std::size_t kCapacity = 32;
+    static constexpr uint8_t kSharedSlot = 0;
+
+    uint8_t acquire()
+    {
+        const uint32_t free = ~m_used & ~(1u << kSharedSlot);
+        if (free == 0) {
+            return kSharedSlot;
+        }
+        const auto slot = static_cast<uint8_t>(__builtin_ctz(free));
+        m_used |= 1u << slot;
+        m_states[slot] = PointerState{};
+        return slot;
+    }
+
+    void release(uint8_t slot)
+    {
+        if (slot != kSharedSlot) {
+            m_used &= ~(1u << slot);
+        }
+    }
+
+    void clear()
+    {
+        m_used = 0;
+        m_states[kSharedSlot] = PointerState{};
+    }
+
+    PointerState &operator[](uint8_t slot) { return m_states[slot]; }
+    const PointerState &operator[](uint8_t slot) const { return m_states[slot]; }
+
+private:
+    static_assert(kCapacity <= 32, "slot usage is a 32-bit mask");
+
+    std::array<PointerState, kCapacity> m_states{};
+    uint32_t m_used{0};
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+// Static user-space probes (USDT) under the "mdb" provider, for perf and bpftrace. Every
+// probe carries the source event time in microseconds (CLOCK_MONOTONIC, 0 for idle
+// releases) and the InputDevice id. An unattached probe is a single nop in the hot path;
+// arguments are integers the caller already holds, so nothing is computed for it either.
+// Without MDB_ENABLE_PROBES or <sys/sdt.h> the macros compile to nothing.
+
+#if defined(MDB_ENABLE_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MDB_PROBES_AVAILABLE 1
+#endif
+#endif
+
+#ifdef MDB_PROBES_AVAILABLE
+#define MDB_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(mdb, name, a1, a2, a3)
+#define MDB_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(mdb, name, a1, a2, a3, a4)
+#else
+#define MDB_PROBE3(name, a1, a2, a3) \
+    do {                             \
+    } while (false)
+#define MDB_PROBE4(name, a1, a2, a3, a4) \
+    do {                                 \
+    } while (false)
+#endif
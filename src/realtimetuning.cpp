@@ -0,0 +1,199 @@
+#include "realtimetuning.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QStringList>
+#include <QVariant>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr std::size_t kStackPrefaultBytes = 256 * 1024;
+// rtkit refuses threads whose process could monopolise a CPU; 200 ms is its default ceiling.
+constexpr rlim_t kRtkitTimeLimitUsec = 200000;
+constexpr int kRtkitTimeoutMs = 2000;
+
+QString errnoText(int error)
+{
+    return QString::fromLocal8Bit(strerror(error));
+}
+
+int nativePolicy(RealtimeOptions::Policy policy)
+{
+    return policy == RealtimeOptions::Policy::RoundRobin ? SCHED_RR : SCHED_FIFO;
+}
+
+QString nativePolicyName(int policy)
+{
+    return policy == SCHED_RR ? QStringLiteral("SCHED_RR") : QStringLiteral("SCHED_FIFO");
+}
+
+bool requestRtkit(pid_t thread, int priority, QString &errorText)
+{
+    rlimit limit{};
+    if (getrlimit(RLIMIT_RTTIME, &limit) == 0 && (limit.rlim_max == RLIM_INFINITY || limit.rlim_max > kRtkitTimeLimitUsec)) {
+        limit.rlim_cur = kRtkitTimeLimitUsec;
+        limit.rlim_max = kRtkitTimeLimitUsec;
+        if (setrlimit(RLIMIT_RTTIME, &limit) < 0) {
+            errorText = QStringLiteral("RLIMIT_RTTIME: %1").arg(errnoText(errno));
+            return false;
+        }
+    }
+
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (!bus.isConnected()) {
+        errorText = QStringLiteral("системна шина D-Bus недоступна");
+        return false;
+    }
+
+    QDBusMessage call = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.RealtimeKit1"),
+                                                       QStringLiteral("/org/freedesktop/RealtimeKit1"),
+                                                       QStringLiteral("org.freedesktop.RealtimeKit1"),
+                                                       QStringLiteral("MakeThreadRealtime"));
+    call << QVariant::fromValue(static_cast<quint64>(thread)) << QVariant::fromValue(static_cast<quint32>(priority));
+
+    const QDBusMessage reply = bus.call(call, QDBus::Block, kRtkitTimeoutMs);
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        errorText = reply.errorMessage();
+        return false;
+    }
+    return true;
+}
+
+QString applyScheduling(const RealtimeOptions &options)
+{
+    if (options.policy == RealtimeOptions::Policy::None) {
+        return QStringLiteral("Планування: звичайне (вимкнено в налаштуваннях)");
+    }
+
+    const int policy = nativePolicy(options.policy);
+    sched_param parameters{};
+    parameters.sched_priority = std::clamp(options.priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+
+    if (sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &parameters) == 0) {
+        return QStringLiteral("Планування: %1, пріоритет %2 — надано")
+            .arg(nativePolicyName(policy))
+            .arg(parameters.sched_priority);
+    }
+
+    const int error = errno;
+    if (error != EPERM) {
+        return QStringLiteral("Планування: не надано — %1").arg(errnoText(error));
+    }
+
+    QString rtkitError;
+    const pid_t thread = static_cast<pid_t>(syscall(SYS_gettid));
+    if (requestRtkit(thread, parameters.sched_priority, rtkitError)) {
+        return QStringLiteral("Планування: SCHED_RR, пріоритет %1 — надано через rtkit").arg(parameters.sched_priority);
+    }
+
+    return QStringLiteral("Планування: не надано — немає CAP_SYS_NICE, rtkit: %1").arg(rtkitError);
+}
+
+QString applyAffinity(const QVector<int> &cpus)
+{
+    if (cpus.isEmpty()) {
+        return QStringLiteral("Прив'язка до CPU: вимкнено");
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    QStringList applied;
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return QStringLiteral("Прив'язка до CPU: не надано — некоректний номер CPU %1").arg(cpu);
+        }
+        CPU_SET(cpu, &set);
+        applied.append(QString::number(cpu));
+    }
+
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        return QStringLiteral("Прив'язка до CPU: не надано — %1").arg(errnoText(error));
+    }
+    return QStringLiteral("Прив'язка до CPU: %1 — надано").arg(applied.join(QStringLiteral(", ")));
+}
+
+[[gnu::noinline]] void prefaultStack()
+{
+    unsigned char buffer[kStackPrefaultBytes];
+    std::memset(buffer, 0, sizeof(buffer));
+    asm volatile("" : : "r"(buffer) : "memory");
+}
+
+QString applyMemoryLock(bool lockMemory)
+{
+    if (!lockMemory) {
+        return QStringLiteral("Блокування пам'яті: вимкнено");
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        return QStringLiteral("Блокування пам'яті: не надано — %1 (перевірте RLIMIT_MEMLOCK)").arg(errnoText(errno));
+    }
+
+    // Keep freed heap inside the locked arena instead of returning it and faulting it back in.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    prefaultStack();
+    return QStringLiteral("Блокування пам'яті: mlockall — надано, стек попередньо завантажено");
+}
+
+QString applyTimerSlack(quint32 slackUs)
+{
+    if (slackUs != 0 && prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(slackUs) * 1000UL, 0, 0, 0) < 0) {
+        return QStringLiteral("Timer slack: не надано — %1").arg(errnoText(errno));
+    }
+
+    const int current = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+    if (current < 0) {
+        return QStringLiteral("Timer slack: невідомо — %1").arg(errnoText(errno));
+    }
+    return QStringLiteral("Timer slack: %1 мкс%2").arg(current / 1000).arg(slackUs == 0 ? QStringLiteral(" (типовий)") : QString());
+}
+} // namespace
+
+RealtimeReport applyRealtimeOptions(const RealtimeOptions &options)
+{
+    RealtimeReport report;
+    report.scheduling = applyScheduling(options);
+    report.affinity = applyAffinity(options.cpus);
+    report.memoryLock = applyMemoryLock(options.lockMemory);
+    report.timerSlack = applyTimerSlack(options.timerSlackUs);
+    return report;
+}
+
+RealtimeOptions::Policy realtimePolicyFromString(const QString &value)
+{
+    const QString normalized = value.trimmed().toLower();
+    if (normalized == QStringLiteral("fifo")) {
+        return RealtimeOptions::Policy::Fifo;
+    }
+    if (normalized == QStringLiteral("rr")) {
+        return RealtimeOptions::Policy::RoundRobin;
+    }
+    return RealtimeOptions::Policy::None;
+}
+
+QString realtimePolicyToString(RealtimeOptions::Policy policy)
+{
+    switch (policy) {
+    case RealtimeOptions::Policy::Fifo:
+        return QStringLiteral("fifo");
+    case RealtimeOptions::Policy::RoundRobin:
+        return QStringLiteral("rr");
+    case RealtimeOptions::Policy::None:
+        break;
+    }
+    return QStringLiteral("none");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+#include <QVector>
+
+#include <cstdint>
+
+struct RealtimeOptions {
+    enum class Policy : uint8_t {
+        None,
+        Fifo,
+        RoundRobin
+    };
+
+    Policy policy{Policy::None};
+    int priority{10};
+    QVector<int> cpus;
+    bool lockMemory{false};
+    // 0 keeps the kernel default (50 us). A larger slack lets the kernel batch the idle
+    // release timer with other wakeups.
+    quint32 timerSlackUs{0};
+};
+
+// One user-facing line per tuning knob, describing what was actually granted.
+struct RealtimeReport {
+    QString scheduling;
+    QString affinity;
+    QString memoryLock;
+    QString timerSlack;
+};
+
+// Applies the options to the calling thread (and, for memory locking, the whole process).
+// Scheduling tries sched_setscheduler() first, which succeeds with CAP_SYS_NICE or a
+// sufficient RLIMIT_RTPRIO, and falls back to asking rtkit over the system bus.
+RealtimeReport applyRealtimeOptions(const RealtimeOptions &options);
+
+RealtimeOptions::Policy realtimePolicyFromString(const QString &value);
+QString realtimePolicyToString(RealtimeOptions::Policy policy);
@@ -0,0 +1,51 @@
+#include "runtimecounters.h"
+
+#include <QJsonValue>
+#include <QString>
+
+const char *RuntimeCounters::key(Counter counter)
+{
+    switch (counter) {
+    case LoopWakeups:
+        return "loop_wakeups";
+    case PointerMotionEvents:
+        return "pointer_motion_events";
+    case AbsoluteMotionEvents:
+        return "absolute_motion_events";
+    case KeyboardKeyEvents:
+        return "keyboard_key_events";
+    case DeviceAddedEvents:
+        return "device_added_events";
+    case DeviceRemovedEvents:
+        return "device_removed_events";
+    case FilteredPointerEvents:
+        return "filtered_pointer_events";
+    case FilteredKeyboardEvents:
+        return "filtered_keyboard_events";
+    case ThresholdRejections:
+        return "threshold_rejections";
+    case RandomizerRejections:
+        return "randomizer_rejections";
+    case PointerArbitrationRejections:
+        return "pointer_arbitration_rejections";
+    case UinputWrites:
+        return "uinput_writes";
+    case UinputWriteErrors:
+        return "uinput_write_errors";
+    case IdleReleases:
+        return "idle_releases";
+    case CounterCount:
+        break;
+    }
+    return "unknown";
+}
+
+QJsonObject RuntimeCounters::toJson() const
+{
+    QJsonObject object;
+    for (int i = 0; i < CounterCount; ++i) {
+        const auto counter = static_cast<Counter>(i);
+        object.insert(QString::fromLatin1(key(counter)), QJsonValue(static_cast<qint64>(value(counter))));
+    }
+    return object;
+}
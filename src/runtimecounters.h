@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QJsonObject>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Event-loop counters for InputController. increment() belongs to the controller thread and
+// is a relaxed load/store pair, not a locked read-modify-write; value() and toJson() may be
+// called from any thread. Each counter is exact, but a set of them is not one consistent cut.
+class RuntimeCounters
+{
+public:
+    enum Counter : uint8_t {
+        LoopWakeups,
+        PointerMotionEvents,
+        AbsoluteMotionEvents,
+        KeyboardKeyEvents,
+        DeviceAddedEvents,
+        DeviceRemovedEvents,
+        FilteredPointerEvents,
+        FilteredKeyboardEvents,
+        ThresholdRejections,
+        RandomizerRejections,
+        PointerArbitrationRejections,
+        UinputWrites,
+        UinputWriteErrors,
+        IdleReleases,
+        CounterCount
+    };
+
+    void increment(Counter counter)
+    {
+        std::atomic<uint64_t> &value = m_values[counter];
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    uint64_t value(Counter counter) const { return m_values[counter].load(std::memory_order_relaxed); }
+
+    // Stable snake_case key used in the JSON dump and by mdb-daemon.
+    static const char *key(Counter counter);
+    QJsonObject toJson() const;
+
+private:
+    // Own cache line, so GUI polling never bounces the lines the event loop writes.
+    alignas(64) std::array<std::atomic<uint64_t>, CounterCount> m_values{};
+};
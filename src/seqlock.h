@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer sequence lock for small POD snapshots. The payload is kept in relaxed
+// atomic words so concurrent readers never race the writer; readers retry on a torn copy.
+template<typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock stores trivially copyable values only");
+
+public:
+    void store(const T &value)
+    {
+        std::array<uint64_t, kWords> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kWords; ++i) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T load() const
+    {
+        std::array<uint64_t, kWords> words{};
+        for (;;) {
+            const uint32_t before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1U) {
+                continue;
+            }
+            for (std::size_t i = 0; i < kWords; ++i) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+
+        T value;
+        std::memcpy(static_cast<void *>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr std::size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> m_sequence{0};
+    std::array<std::atomic<uint64_t>, kWords> m_words{};
+};
@@ -0,0 +1,87 @@
+#include "settingssaver.h"
+
+#include <QFile>
+#include <QMetaObject>
+#include <QTimer>
+
+#include <sys/stat.h>
+
+SettingsSaver::SettingsSaver(const QString &path, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+    , m_worker(new QObject)
+    , m_timer(new QTimer(this))
+{
+    m_thread.setObjectName(QStringLiteral("mdb-settings"));
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+
+    m_timer->setSingleShot(true);
+    m_timer->setInterval(kQuietPeriodMs);
+    connect(m_timer, &QTimer::timeout, this, &SettingsSaver::writePending);
+}
+
+SettingsSaver::~SettingsSaver()
+{
+    flush();
+    QMetaObject::invokeMethod(m_worker, [this]() { m_store.reset(); }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void SettingsSaver::schedule(const AppSettings &settings)
+{
+    m_pending = settings;
+    m_hasPending = true;
+    m_timer->start();
+}
+
+void SettingsSaver::flush()
+{
+    m_timer->stop();
+    writePending();
+    // The worker runs writes in order, so an empty blocking call returns after the last one.
+    QMetaObject::invokeMethod(m_worker, []() {}, Qt::BlockingQueuedConnection);
+}
+
+bool SettingsSaver::isLastWrite() const
+{
+    return m_lastWrite.size >= 0 && stampOf(m_path) == m_lastWrite;
+}
+
+SettingsSaver::FileStamp SettingsSaver::stampOf(const QString &path)
+{
+    struct stat info {};
+    if (::stat(QFile::encodeName(path).constData(), &info) != 0) {
+        return {};
+    }
+    // QSettings replaces the file on every write, so the inode changes even within one mtime tick.
+    return {static_cast<uint64_t>(info.st_dev), static_cast<uint64_t>(info.st_ino), static_cast<int64_t>(info.st_size),
+            static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec};
+}
+
+void SettingsSaver::writePending()
+{
+    if (!m_hasPending) {
+        return;
+    }
+    m_hasPending = false;
+    ++m_inFlight;
+
+    QMetaObject::invokeMethod(m_worker, [this, settings = m_pending]() {
+        if (!m_store) {
+            m_store = std::make_unique<SettingsStore>(m_path);
+        }
+        if (!m_store->save(settings)) {
+            emit saveFailed(QStringLiteral("Не вдалося зберегти налаштування у %1.").arg(m_store->fileName()));
+        }
+        // save() has synced by now; the watcher only reports after its settle delay, so this
+        // reaches the GUI thread before the inotify event for the same write does.
+        const FileStamp stamp = stampOf(m_store->fileName());
+        QMetaObject::invokeMethod(this, [this, stamp]() {
+            --m_inFlight;
+            m_lastWrite = stamp;
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "appsettings.h"
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+
+#include <cstdint>
+#include <memory>
+
+class QTimer;
+
+// Debounced, off-thread persistence for the GUI. schedule() only keeps the latest snapshot;
+// it is written on a worker thread once nothing has changed for kQuietPeriodMs, so a slider
+// drag costs one INI write instead of one per step.
+class SettingsSaver : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int kQuietPeriodMs = 400;
+
+    explicit SettingsSaver(const QString &path, QObject *parent = nullptr);
+    ~SettingsSaver() override;
+
+    void schedule(const AppSettings &settings);
+    // True from schedule() until the worker's write has synced and been reported back.
+    bool isPending() const { return m_hasPending || m_inFlight > 0; }
+    // True while the file on disk is still the one our last write produced, so a watcher
+    // event for it is our own echo rather than an outside edit.
+    bool isLastWrite() const;
+    // Writes anything still pending and waits until the worker has finished writing.
+    void flush();
+
+signals:
+    void saveFailed(const QString &message);
+
+private:
+    struct FileStamp {
+        uint64_t device{0};
+        uint64_t inode{0};
+        int64_t size{-1};
+        int64_t mtimeNs{0};
+
+        bool operator==(const FileStamp &other) const
+        {
+            return device == other.device && inode == other.inode && size == other.size && mtimeNs == other.mtimeNs;
+        }
+    };
+
+    static FileStamp stampOf(const QString &path);
+    void writePending();
+
+    QString m_path;
+    QThread m_thread;
+    // Lives on m_thread; m_store is created, used and destroyed only from its queue.
+    QObject *m_worker{nullptr};
+    std::unique_ptr<SettingsStore> m_store;
+    QTimer *m_timer{nullptr};
+    AppSettings m_pending;
+    bool m_hasPending{false};
+    // GUI-thread only; the worker reports each finished write back through the event loop.
+    int m_inFlight{0};
+    FileStamp m_lastWrite;
+};
@@ -0,0 +1,166 @@
+#include "telemetrygraph.h"
+
+#include <QColor>
+#include <QHideEvent>
+#include <QPainter>
+#include <QPalette>
+#include <QPen>
+#include <QShowEvent>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+constexpr double kKeyLaneLevel = 0.9;
+constexpr double kHeadroom = 1.1;
+const QColor kKeyColor(0xE0, 0x8E, 0x2B);
+}
+
+TelemetryGraph::TelemetryGraph(InputController *controller, QWidget *parent)
+    : QWidget(parent)
+    , m_controller(controller)
+    , m_frameTimer(new QTimer(this))
+    , m_samples(InputController::MotionTelemetry::kCapacity)
+    , m_emptyText(QStringLiteral("Затисніть клавішу активації й рухайте мишею"))
+{
+    m_motionPath.reserve(static_cast<int>(InputController::MotionTelemetry::kCapacity));
+    m_thresholdPath.reserve(static_cast<int>(4 * InputController::MotionTelemetry::kCapacity));
+    m_keyPath.reserve(static_cast<int>(2 * InputController::MotionTelemetry::kCapacity));
+
+    m_frameTimer->setInterval(kFrameIntervalMs);
+    connect(m_frameTimer, &QTimer::timeout, this, &TelemetryGraph::refresh);
+}
+
+void TelemetryGraph::setKeyMap(const KeyMap &keyMap)
+{
+    m_keyMap = keyMap;
+    update();
+}
+
+QSize TelemetryGraph::sizeHint() const
+{
+    return QSize(480, 160);
+}
+
+void TelemetryGraph::showEvent(QShowEvent *event)
+{
+    m_controller->setTelemetryEnabled(true);
+    m_lastTotal = 0;
+    m_frameTimer->start();
+    QWidget::showEvent(event);
+}
+
+void TelemetryGraph::hideEvent(QHideEvent *event)
+{
+    m_frameTimer->stop();
+    m_controller->setTelemetryEnabled(false);
+    QWidget::hideEvent(event);
+}
+
+void TelemetryGraph::refresh()
+{
+    const InputController::MotionTelemetry &telemetry = m_controller->motionTelemetry();
+    const uint64_t total = telemetry.total();
+    if (total != m_lastTotal) {
+        m_lastTotal = total;
+        m_sampleCount = telemetry.readLatest(m_samples.data(), m_samples.size());
+    }
+    // Sample times are CLOCK_MONOTONIC, which is what steady_clock reads on Linux.
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    m_nowUsec = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+    update();
+}
+
+int TelemetryGraph::keyLane(uint16_t keycode) const
+{
+    if (keycode == 0) {
+        return 0;
+    }
+    for (unsigned cell = 1; cell < KeyMap::kCells; ++cell) {
+        if (m_keyMap.keys[cell] == keycode) {
+            const unsigned signX = cell % 3;
+            return signX == 1 ? -1 : signX == 2 ? 1 : 0;
+        }
+    }
+    return 0;
+}
+
+void TelemetryGraph::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Base));
+    if (m_sampleCount == 0) {
+        painter.setPen(palette().color(QPalette::PlaceholderText));
+        painter.drawText(rect(), Qt::AlignCenter, m_emptyText);
+        return;
+    }
+
+    const TelemetrySample *begin = m_samples.data();
+    const TelemetrySample *end = begin + m_sampleCount;
+    const uint64_t newest = std::max(m_nowUsec, end[-1].timeUsec);
+    const uint64_t oldest = newest > kWindowUsec ? newest - kWindowUsec : 0;
+    const TelemetrySample *first = std::lower_bound(begin, end, oldest, [](const TelemetrySample &sample, uint64_t timeUsec) {
+        return sample.timeUsec < timeUsec;
+    });
+    if (first == end) {
+        first = end - 1;
+    }
+
+    double range = 1.0;
+    for (const TelemetrySample *sample = first; sample != end; ++sample) {
+        range = std::max({range, std::fabs(static_cast<double>(sample->dx)), 2.0 * sample->threshold});
+    }
+    range *= kHeadroom;
+
+    const QRectF area = QRectF(rect()).adjusted(1.0, 1.0, -1.0, -1.0);
+    const double middle = area.center().y();
+    const double halfHeight = area.height() / 2.0;
+    const auto xFor = [&area, oldest](uint64_t timeUsec) {
+        return area.left() + area.width() * static_cast<double>(timeUsec - std::min(timeUsec, oldest)) / kWindowUsec;
+    };
+    const auto yFor = [middle, halfHeight, range](double value) { return middle - value / range * halfHeight; };
+
+    m_motionPath.clear();
+    m_thresholdPath.clear();
+    m_keyPath.clear();
+    for (const double sign : {1.0, -1.0}) {
+        for (const TelemetrySample *sample = first; sample != end; ++sample) {
+            const QPointF point(xFor(sample->timeUsec), yFor(sign * sample->threshold));
+            if (sample == first) {
+                m_thresholdPath.moveTo(point);
+            } else {
+                m_thresholdPath.lineTo(m_thresholdPath.currentPosition().x(), point.y());
+                m_thresholdPath.lineTo(point);
+            }
+        }
+    }
+    for (const TelemetrySample *sample = first; sample != end; ++sample) {
+        const double x = xFor(sample->timeUsec);
+        const QPointF motion(x, yFor(sample->dx));
+        const double keyY = yFor(keyLane(sample->heldKeycode) * kKeyLaneLevel * range);
+        if (sample == first) {
+            m_motionPath.moveTo(motion);
+            m_keyPath.moveTo(x, keyY);
+        } else {
+            m_motionPath.lineTo(motion);
+            m_keyPath.lineTo(x, m_keyPath.currentPosition().y());
+            m_keyPath.lineTo(x, keyY);
+        }
+    }
+    m_keyPath.lineTo(area.right(), m_keyPath.currentPosition().y());
+
+    painter.setPen(QPen(palette().color(QPalette::Mid), 1.0));
+    painter.drawLine(QPointF(area.left(), middle), QPointF(area.right(), middle));
+    painter.setPen(QPen(palette().color(QPalette::Mid), 1.0, Qt::DashLine));
+    painter.drawPath(m_thresholdPath);
+    painter.setPen(QPen(kKeyColor, 2.0));
+    painter.drawPath(m_keyPath);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setPen(QPen(palette().color(QPalette::Highlight), 1.0));
+    painter.drawPath(m_motionPath);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "directionengine.h"
+#include "inputcontroller.h"
+
+#include <QPainterPath>
+#include <QString>
+#include <QWidget>
+
+#include <vector>
+
+class QTimer;
+
+// Live plot of the last second of motion decisions: dx, the device threshold and the key
+// being held. Reads InputController::motionTelemetry() on a frame timer while visible and
+// turns the telemetry off while hidden; sample storage and paths are allocated once.
+class TelemetryGraph : public QWidget
+{
+    Q_OBJECT
+public:
+    static constexpr int kFrameIntervalMs = 33;
+    static constexpr uint64_t kWindowUsec = 1000000;
+
+    explicit TelemetryGraph(InputController *controller, QWidget *parent = nullptr);
+
+    // Tells which held keys are "left" and which "right" for the key lane.
+    void setKeyMap(const KeyMap &keyMap);
+    QSize sizeHint() const override;
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    void refresh();
+    int keyLane(uint16_t keycode) const;
+
+    InputController *m_controller{nullptr};
+    QTimer *m_frameTimer{nullptr};
+    KeyMap m_keyMap;
+    std::vector<TelemetrySample> m_samples;
+    std::size_t m_sampleCount{0};
+    uint64_t m_lastTotal{0};
+    // Right edge of the plot; advances every frame so the graph scrolls while nothing moves.
+    uint64_t m_nowUsec{0};
+    QPainterPath m_motionPath;
+    QPainterPath m_thresholdPath;
+    QPainterPath m_keyPath;
+    QString m_emptyText;
+};
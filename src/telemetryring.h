@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// One motion decision, as plotted by the live graph.
+struct TelemetrySample {
+    uint64_t timeUsec{0};
+    float dx{0.0f};
+    float dxUnaccelerated{0.0f};
+    float threshold{0.0f};
+    uint16_t heldKeycode{0};
+    uint8_t motionResult{0};
+    uint8_t reserved{0};
+};
+
+// Single-producer overwriting ring. The producer never waits and never learns whether
+// anyone reads; readers copy the newest samples and drop any the producer overwrote while
+// they were copying. Slots are relaxed atomic words, as in SeqLock, so there is no data race.
+template<std::size_t Capacity>
+class TelemetryRing
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<TelemetrySample>::value, "TelemetrySample must stay trivially copyable");
+
+public:
+    static constexpr std::size_t kCapacity = Capacity;
+
+    void push(const TelemetrySample &sample)
+    {
+        std::array<uint64_t, kWords> words{};
+        std::memcpy(words.data(), &sample, sizeof(TelemetrySample));
+
+        const uint64_t index = m_written.load(std::memory_order_relaxed);
+        m_claimed.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        Slot &slot = m_slots[index & (Capacity - 1)];
+        for (std::size_t i = 0; i < kWords; ++i) {
+            slot[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_written.store(index + 1, std::memory_order_release);
+    }
+
+    // Copies up to maxCount of the newest samples into out, oldest first, and returns how
+    // many are valid. Slots the producer overwrote during the copy are dropped from the front.
+    std::size_t readLatest(TelemetrySample *out, std::size_t maxCount) const
+    {
+        const uint64_t end = m_written.load(std::memory_order_acquire);
+        const uint64_t available = end < Capacity ? end : Capacity;
+        const uint64_t count = available < maxCount ? available : maxCount;
+        const uint64_t begin = end - count;
+
+        for (uint64_t index = begin; index < end; ++index) {
+            std::array<uint64_t, kWords> words{};
+            const Slot &slot = m_slots[index & (Capacity - 1)];
+            for (std::size_t i = 0; i < kWords; ++i) {
+                words[i] = slot[i].load(std::memory_order_relaxed);
+            }
+            std::memcpy(static_cast<void *>(&out[index - begin]), words.data(), sizeof(TelemetrySample));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // Anything the producer started writing since may have replaced the oldest copies.
+        const uint64_t claimed = m_claimed.load(std::memory_order_relaxed);
+        const uint64_t firstIntact = claimed > Capacity ? claimed - Capacity : 0;
+        if (firstIntact <= begin) {
+            return static_cast<std::size_t>(count);
+        }
+        if (firstIntact >= end) {
+            return 0;
+        }
+        const uint64_t skipped = firstIntact - begin;
+        std::memmove(static_cast<void *>(out), out + skipped, static_cast<std::size_t>(count - skipped) * sizeof(TelemetrySample));
+        return static_cast<std::size_t>(count - skipped);
+    }
+
+    // Total number of samples ever pushed.
+    uint64_t total() const { return m_written.load(std::memory_order_acquire); }
+
+private:
+    static constexpr std::size_t kWords = (sizeof(TelemetrySample) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    using Slot = std::array<std::atomic<uint64_t>, kWords>;
+
+    alignas(64) std::atomic<uint64_t> m_claimed{0};
+    std::atomic<uint64_t> m_written{0};
+    alignas(64) std::array<Slot, Capacity> m_slots{};
+};
@@ -0,0 +1,91 @@
+#include "tracerecorder.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr uint64_t kMaximumCapacity = uint64_t{1} << 26;
+
+uint64_t roundUpToPowerOfTwo(uint64_t value)
+{
+    uint64_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+} // namespace
+
+TraceRecorder::~TraceRecorder()
+{
+    close();
+}
+
+bool TraceRecorder::open(const char *path, uint64_t capacity)
+{
+    close();
+
+    if (capacity == 0 || capacity > kMaximumCapacity) {
+        errno = EINVAL;
+        return false;
+    }
+    capacity = roundUpToPowerOfTwo(capacity);
+
+    const int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    const std::size_t size = sizeof(TraceFileHeader) + capacity * sizeof(TraceRecord);
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        errno = error;
+        return false;
+    }
+
+    m_header = static_cast<TraceFileHeader *>(mapping);
+    m_records = reinterpret_cast<TraceRecord *>(static_cast<char *>(mapping) + sizeof(TraceFileHeader));
+    m_mappingSize = size;
+    m_mask = capacity - 1;
+    m_index = 0;
+
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    std::memcpy(m_header->magic, kMagic, sizeof(kMagic));
+    m_header->version = kVersion;
+    m_header->recordSize = sizeof(TraceRecord);
+    m_header->capacity = capacity;
+    m_header->writeIndex = 0;
+    m_header->startMonotonicNs = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+    return true;
+}
+
+void TraceRecorder::close()
+{
+    if (!m_header) {
+        return;
+    }
+
+    msync(m_header, m_mappingSize, MS_ASYNC);
+    munmap(m_header, m_mappingSize);
+    m_header = nullptr;
+    m_records = nullptr;
+    m_mappingSize = 0;
+    m_mask = 0;
+    m_index = 0;
+}
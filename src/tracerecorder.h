@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class TraceEventType : uint8_t {
+    DeviceAdded,
+    DeviceRemoved,
+    PointerMotion,
+    PointerMotionAbsolute,
+    KeyboardKey,
+    IdleRelease,
+    CoalescedMotion
+};
+
+// One processed input event and the key transition it caused, if any.
+struct TraceRecord {
+    uint64_t timeUsec;
+    float dx;
+    float dxUnaccelerated;
+    uint16_t key;
+    uint16_t deviceId;
+    TraceEventType type;
+    uint8_t pressed;
+    uint8_t motionResult;
+    uint8_t reserved0;
+    uint16_t releasedKeycode;
+    uint16_t pressedKeycode;
+    uint32_t reserved1;
+};
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord is part of the on-disk format");
+
+// writeIndex counts every record ever committed; the newest record lives at
+// (writeIndex - 1) % capacity and the file wraps once writeIndex exceeds capacity.
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;
+    uint64_t writeIndex;
+    uint64_t startMonotonicNs;
+    uint8_t reserved[24];
+};
+static_assert(sizeof(TraceFileHeader) == 64, "TraceFileHeader is part of the on-disk format");
+
+// Appends TraceRecords to a memory-mapped ring file. The mapping is populated up front,
+// so recording is a store into the slot plus an index bump and never enters the kernel.
+class TraceRecorder
+{
+public:
+    static constexpr char kMagic[8] = {'M', 'D', 'B', 'T', 'R', 'A', 'C', 'E'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint64_t kDefaultCapacity = uint64_t{1} << 21;
+
+    TraceRecorder() = default;
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder &) = delete;
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+    // Capacity is rounded up to a power of two. Returns false with errno set on failure.
+    bool open(const char *path, uint64_t capacity);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    // Returns a zeroed slot to fill before commit(), or nullptr when not recording.
+    TraceRecord *begin()
+    {
+        if (!m_header) {
+            return nullptr;
+        }
+        TraceRecord *record = &m_records[m_index & m_mask];
+        *record = TraceRecord{};
+        return record;
+    }
+
+    void commit()
+    {
+        ++m_index;
+        __atomic_store_n(&m_header->writeIndex, m_index, __ATOMIC_RELEASE);
+    }
+
+private:
+    TraceFileHeader *m_header{nullptr};
+    TraceRecord *m_records{nullptr};
+    std::size_t m_mappingSize{0};
+    uint64_t m_mask{0};
+    uint64_t m_index{0};
+};
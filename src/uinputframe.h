@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+// Collects key transitions for one uinput report and submits them, terminated by a
+// single SYN_REPORT, with one write(). Readers see the whole transition atomically.
+class UinputFrame
+{
+public:
+    static constexpr std::size_t kMaxKeys = 15;
+
+    void clear() { m_count = 0; }
+    bool isEmpty() const { return m_count == 0; }
+    std::size_t keyCount() const { return m_count; }
+    // CLOCK_MONOTONIC time, in nanoseconds, stamped on the most recently submitted frame.
+    uint64_t lastSubmitNs() const { return m_lastSubmitNs; }
+
+    bool addKey(uint16_t keycode, int value)
+    {
+        if (m_count == kMaxKeys) {
+            return false;
+        }
+
+        input_event &event = m_events[m_count++];
+        event.type = EV_KEY;
+        event.code = keycode;
+        event.value = value;
+        return true;
+    }
+
+    // Returns false and leaves errno set when the kernel rejected the frame.
+    bool submit(int fd)
+    {
+        if (m_count == 0) {
+            return true;
+        }
+
+        input_event &sync = m_events[m_count];
+        sync.type = EV_SYN;
+        sync.code = SYN_REPORT;
+        sync.value = 0;
+
+        timespec now{};
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        m_lastSubmitNs = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+        for (std::size_t i = 0; i <= m_count; ++i) {
+            m_events[i].input_event_sec = now.tv_sec;
+            m_events[i].input_event_usec = now.tv_nsec / 1000;
+        }
+
+        const std::size_t bytes = (m_count + 1) * sizeof(input_event);
+        m_count = 0;
+
+        ssize_t written = 0;
+        do {
+            written = write(fd, m_events.data(), bytes);
+        } while (written < 0 && errno == EINTR);
+
+        if (written < 0) {
+            return false;
+        }
+        if (static_cast<std::size_t>(written) != bytes) {
+            errno = EIO;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::array<input_event, kMaxKeys + 1> m_events{};
+    std::size_t m_count{0};
+    uint64_t m_lastSubmitNs{0};
+};
@@ -0,0 +1,334 @@
+// Unprivileged checks of the mdb_core building blocks: no devices, no uinput, no Qt event
+// loop. Prints every failed check and exits with 1 if there was any.
+
+#include "brandmatcher.h"
+#include "directionengine.h"
+#include "latencyhistogram.h"
+#include "seqlock.h"
+#include "spscqueue.h"
+
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+int g_failures = 0;
+
+void check(bool condition, const char *what, int line)
+{
+    if (!condition) {
+        std::fprintf(stderr, "FAIL line %d: %s\n", line, what);
+        ++g_failures;
+    }
+}
+
+#define CHECK(...) check((__VA_ARGS__), #__VA_ARGS__, __LINE__)
+
+class RecordingSink
+{
+public:
+    void applyTransition(uint16_t releasedKeycode, uint16_t pressedKeycode) { m_transitions.emplace_back(releasedKeycode, pressedKeycode); }
+
+    std::vector<std::pair<uint16_t, uint16_t>> &transitions() { return m_transitions; }
+
+private:
+    std::vector<std::pair<uint16_t, uint16_t>> m_transitions;
+};
+
+using Transition = std::pair<uint16_t, uint16_t>;
+using TestEngine = DirectionEngine<DeviceThreshold, NoRandomizer, RecordingSink>;
+
+void testDirectionEngine()
+{
+    TestEngine engine{RecordingSink{}};
+    std::vector<Transition> &transitions = engine.sink().transitions();
+
+    CHECK(engine.handleMotion(5.0, 5.0) == MotionResult::Inactive);
+    CHECK(transitions.empty());
+
+    CHECK(engine.handleKey(KEY_LEFTSHIFT, true));
+    CHECK(!engine.handleKey(KEY_LEFTSHIFT, true));
+    CHECK(!engine.handleKey(KEY_Q, true));
+
+    engine.threshold().value = 0.4;
+    CHECK(engine.handleMotion(0.3, 0.3) == MotionResult::BelowThreshold);
+    CHECK(engine.handleMotion(0.4, 0.4) == MotionResult::Applied);
+    CHECK(transitions == std::vector<Transition>{{0, KEY_D}});
+
+    // Same direction again holds the key without a new transition.
+    CHECK(engine.handleMotion(2.0, 2.0) == MotionResult::Applied);
+    CHECK(transitions.size() == 1);
+
+    // A flip is one transition carrying both keys; the larger of dx and raw dx decides.
+    CHECK(engine.handleMotion(0.1, -0.5) == MotionResult::Applied);
+    CHECK(transitions.back() == Transition(KEY_D, KEY_A));
+    CHECK(transitions.size() == 2);
+
+    // A per-device threshold set between motions applies to the next one.
+    engine.threshold().value = 1.0;
+    CHECK(engine.handleMotion(0.8, 0.8) == MotionResult::BelowThreshold);
+    CHECK(engine.state().heldKeycode == KEY_A);
+
+    CHECK(engine.handleKey(KEY_LEFTSHIFT, false));
+    CHECK(transitions.back() == Transition(KEY_A, 0));
+    CHECK(engine.state().heldKeycode == 0);
+
+    DirectionEngine<DeviceThreshold, PercentRandomizer, RecordingSink> rejecting(RecordingSink{}, DeviceThreshold{}, PercentRandomizer(1, 0, 0));
+    rejecting.handleKey(KEY_LEFTSHIFT, true);
+    CHECK(rejecting.handleMotion(3.0, 3.0) == MotionResult::Rejected);
+    CHECK(rejecting.sink().transitions().empty());
+}
+
+void testHysteresis()
+{
+    TestEngine engine{RecordingSink{}};
+    CHECK(engine.passesHysteresis(-0.5, -0.5, 0.0, 0.0, 1.0));
+
+    engine.handleKey(KEY_LEFTSHIFT, true);
+    engine.handleMotion(2.0, 2.0);
+    CHECK(engine.state().heldKeycode == KEY_D);
+
+    // A coalesced flip below the hysteresis keeps the held key, one at or above it switches.
+    CHECK(!engine.passesHysteresis(-0.5, -0.5, 0.0, 0.0, 1.0));
+    CHECK(!engine.passesHysteresis(-0.9, -0.2, 0.0, 0.0, 1.0));
+    CHECK(engine.passesHysteresis(-1.0, -1.0, 0.0, 0.0, 1.0));
+    CHECK(engine.passesHysteresis(-0.2, -1.2, 0.0, 0.0, 1.0));
+    // Staying on the held key or falling below threshold never needs the hysteresis.
+    CHECK(engine.passesHysteresis(0.5, 0.5, 0.0, 0.0, 1.0));
+    CHECK(engine.passesHysteresis(0.1, -0.1, 0.0, 0.0, 1.0));
+    CHECK(engine.passesHysteresis(-0.5, -0.5, 0.0, 0.0, 0.0));
+
+    // Y only counts when the map has vertical keys.
+    CHECK(!engine.passesHysteresis(-0.5, -0.5, 3.0, 3.0, 1.0));
+    engine.setKeyMap(KeyMap::fromDirections(KEY_A, KEY_D, KEY_W, KEY_S));
+    engine.handleMotion(2.0, 2.0);
+    CHECK(engine.state().heldKeycode == KEY_D);
+    CHECK(engine.passesHysteresis(-0.5, -0.5, 3.0, 3.0, 1.0));
+}
+
+void testKeyMap()
+{
+    const KeyMap horizontal = KeyMap::fromDirections(KEY_A, KEY_D, 0, 0);
+    CHECK(!horizontal.usesY);
+    CHECK(horizontal.keys[KeyMap::cell(1, 0)] == KEY_A);
+    CHECK(horizontal.keys[KeyMap::cell(2, 0)] == KEY_D);
+
+    // Without vertical keys a vertical motion is below threshold, not a release.
+    TestEngine engine(RecordingSink{}, DeviceThreshold{}, NoRandomizer{}, DirectionState{}, horizontal);
+    engine.handleKey(KEY_LEFTSHIFT, true);
+    engine.handleMotion(2.0, 2.0);
+    CHECK(engine.handleMotion(0.0, 0.0, 5.0, 5.0) == MotionResult::BelowThreshold);
+    CHECK(engine.state().heldKeycode == KEY_D);
+
+    const KeyMap full = KeyMap::fromDirections(KEY_A, KEY_D, KEY_W, KEY_S);
+    CHECK(full.usesY);
+    CHECK(full.keys[KeyMap::cell(0, 1)] == KEY_W);
+    CHECK(full.keys[KeyMap::cell(0, 2)] == KEY_S);
+    // Unset diagonals take the horizontal key first.
+    CHECK(full.keys[KeyMap::cell(1, 1)] == KEY_A);
+    CHECK(full.keys[KeyMap::cell(2, 2)] == KEY_D);
+
+    const KeyMap vertical = KeyMap::fromDirections(0, 0, KEY_W, KEY_S);
+    CHECK(vertical.usesY);
+    CHECK(vertical.keys[KeyMap::cell(1, 1)] == KEY_W);
+    CHECK(vertical.keys[KeyMap::cell(2, 2)] == KEY_S);
+
+    const KeyMap diagonals = KeyMap::fromDirections(KEY_A, KEY_D, KEY_W, KEY_S, KEY_Q, KEY_E, KEY_Z, KEY_C);
+    CHECK(diagonals.keys[KeyMap::cell(1, 1)] == KEY_Q);
+    CHECK(diagonals.keys[KeyMap::cell(2, 1)] == KEY_E);
+    CHECK(diagonals.keys[KeyMap::cell(1, 2)] == KEY_Z);
+    CHECK(diagonals.keys[KeyMap::cell(2, 2)] == KEY_C);
+
+    const KeyMap defaults;
+    CHECK(defaults.keys[KeyMap::cell(1, 0)] == KEY_A);
+    CHECK(defaults.keys[KeyMap::cell(2, 0)] == KEY_D);
+    CHECK(!defaults.usesY);
+}
+
+void testBrandMatcher()
+{
+    const BrandMatcher open;
+    CHECK(open.allows(QStringLiteral("Any Mouse"), 0x1234, 0x5678));
+
+    // Overlapping patterns: "he" ends inside "ushers"; "she" and "hers" overlap each other.
+    const BrandMatcher matcher(QStringList{QStringLiteral("she"), QStringLiteral("Hers"), QStringLiteral("046d:C52B")},
+                               QStringList{QStringLiteral("he"), QStringLiteral("dead:BEEF")});
+    CHECK(!matcher.allows(QStringLiteral("ushers"), 0, 0));
+    CHECK(!matcher.allows(QStringLiteral("The Mouse"), 0x046d, 0xc52b));
+
+    const BrandMatcher allowOnly(QStringList{QStringLiteral("logitech"), QStringLiteral("razer"), QStringLiteral("046d:c52b")}, QStringList{});
+    CHECK(allowOnly.allows(QStringLiteral("Logitech G Pro"), 0, 0));
+    CHECK(allowOnly.allows(QStringLiteral("USB RAZER viper"), 0, 0));
+    CHECK(allowOnly.allows(QStringLiteral("Receiver"), 0x046d, 0xc52b));
+    CHECK(!allowOnly.allows(QStringLiteral("Receiver"), 0x046d, 0xc52c));
+    CHECK(!allowOnly.allows(QStringLiteral("logitec"), 0, 0));
+    // A partial match of one pattern must not hide another that starts inside it.
+    CHECK(allowOnly.allows(QStringLiteral("rarazer"), 0, 0));
+
+    const BrandMatcher blocking(QStringList{QStringLiteral("mouse")}, QStringList{QStringLiteral("MouseDirectionBinder"), QStringLiteral("dead:beef")});
+    CHECK(blocking.allows(QStringLiteral("Gaming Mouse"), 0, 0));
+    CHECK(!blocking.allows(QStringLiteral("MouseDirectionBinder"), 0, 0));
+    CHECK(!blocking.allows(QStringLiteral("Gaming Mouse"), 0xdead, 0xbeef));
+
+    quint32 vendor = 0;
+    quint32 product = 0;
+    CHECK(BrandMatcher::parseDeviceId(QStringLiteral(" 046D:c52b "), vendor, product));
+    CHECK(vendor == 0x046d && product == 0xc52b);
+    CHECK(!BrandMatcher::parseDeviceId(QStringLiteral("logitech"), vendor, product));
+    CHECK(!BrandMatcher::parseDeviceId(QStringLiteral("12345:1"), vendor, product));
+    CHECK(!BrandMatcher::parseDeviceId(QStringLiteral("xyz:1"), vendor, product));
+    CHECK(!BrandMatcher::parseDeviceId(QStringLiteral("1:2:3"), vendor, product));
+}
+
+// The bucket [lower, upper] holding a single recorded value.
+LatencyHistogram::Bucket bucketOf(uint64_t nanoseconds)
+{
+    LatencyHistogram histogram;
+    histogram.record(nanoseconds);
+    const std::vector<LatencyHistogram::Bucket> buckets = histogram.buckets();
+    return buckets.size() == 1 ? buckets.front() : LatencyHistogram::Bucket{};
+}
+
+void testLatencyHistogram()
+{
+    // Exact below 64 ns, then 32 sub-buckets per power of two.
+    for (const uint64_t value : {0ULL, 1ULL, 31ULL, 32ULL, 63ULL}) {
+        const LatencyHistogram::Bucket bucket = bucketOf(value);
+        CHECK(bucket.lowerNs == value && bucket.upperNs == value && bucket.count == 1);
+    }
+    CHECK(bucketOf(64).lowerNs == 64 && bucketOf(64).upperNs == 65);
+    CHECK(bucketOf(65).lowerNs == 64);
+    CHECK(bucketOf(66).lowerNs == 66);
+    CHECK(bucketOf(127).lowerNs == 126 && bucketOf(127).upperNs == 127);
+    CHECK(bucketOf(128).lowerNs == 128 && bucketOf(128).upperNs == 131);
+
+    uint64_t previousUpper = 0;
+    for (uint64_t value = 1; value < (1ULL << 40); value = value * 3 / 2 + 1) {
+        const LatencyHistogram::Bucket bucket = bucketOf(value);
+        CHECK(bucket.lowerNs <= value && value <= bucket.upperNs);
+        CHECK(bucket.lowerNs >= previousUpper);
+        CHECK((bucket.upperNs - bucket.lowerNs + 1) * 32 <= bucket.lowerNs || bucket.lowerNs < 64);
+        previousUpper = bucket.upperNs;
+    }
+    // Everything past the top of the range lands in the last bucket.
+    CHECK(bucketOf(1ULL << 45).upperNs == (1ULL << 40) - 1);
+
+    LatencyHistogram histogram;
+    CHECK(histogram.summary().count == 0);
+    for (uint64_t i = 1; i <= 100; ++i) {
+        histogram.record(i * 1000);
+    }
+    const LatencyHistogram::Summary summary = histogram.summary();
+    CHECK(summary.count == 100);
+    CHECK(summary.max == 100000);
+    CHECK(summary.p50 >= 50000 && summary.p50 <= 50000 + 50000 / 32);
+    CHECK(summary.p99 >= 99000 && summary.p99 <= 100000);
+    histogram.reset();
+    CHECK(histogram.summary().count == 0 && histogram.buckets().empty());
+}
+
+void testSpscQueue()
+{
+    SpscQueue<uint32_t, 4> small;
+    uint32_t value = 0;
+    CHECK(!small.tryPop(value));
+    for (uint32_t i = 0; i < 4; ++i) {
+        CHECK(small.push(i));
+    }
+    CHECK(!small.push(4));
+    CHECK(small.tryPop(value) && value == 0);
+    CHECK(small.push(4));
+    for (uint32_t expected = 1; expected <= 4; ++expected) {
+        CHECK(small.tryPop(value) && value == expected);
+    }
+    CHECK(!small.tryPop(value));
+
+    constexpr uint32_t kCount = 1000000;
+    SpscQueue<uint32_t, 256> queue;
+    std::thread producer([&queue] {
+        for (uint32_t i = 0; i < kCount; ++i) {
+            while (!queue.push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    bool ordered = true;
+    for (uint32_t expected = 0; expected < kCount;) {
+        if (queue.tryPop(value)) {
+            ordered = ordered && value == expected;
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(ordered);
+    CHECK(!queue.tryPop(value));
+}
+
+void testSeqLock()
+{
+    struct Snapshot {
+        uint64_t value;
+        uint64_t inverse;
+        uint32_t tail;
+    };
+
+    SeqLock<Snapshot> single;
+    CHECK(single.load().value == 0);
+    single.store({7, ~7ULL, 7});
+    const Snapshot stored = single.load();
+    CHECK(stored.value == 7 && stored.inverse == ~7ULL && stored.tail == 7);
+
+    // Every snapshot a reader sees while the writer runs is whole and no older than the last.
+    SeqLock<Snapshot> lock;
+    lock.store({0, ~0ULL, 0});
+
+    constexpr uint64_t kStores = 200000;
+    std::atomic<bool> done{false};
+    std::thread writer([&lock, &done] {
+        for (uint64_t i = 1; i <= kStores; ++i) {
+            lock.store({i, ~i, static_cast<uint32_t>(i)});
+        }
+        done.store(true, std::memory_order_release);
+    });
+    bool consistent = true;
+    bool monotonic = true;
+    uint64_t last = 0;
+    while (!done.load(std::memory_order_acquire)) {
+        const Snapshot snapshot = lock.load();
+        consistent = consistent && snapshot.inverse == ~snapshot.value && snapshot.tail == static_cast<uint32_t>(snapshot.value);
+        monotonic = monotonic && snapshot.value >= last;
+        last = snapshot.value;
+    }
+    writer.join();
+    CHECK(consistent);
+    CHECK(monotonic);
+    CHECK(lock.load().value == kStores);
+}
+} // namespace
+
+int main()
+{
+    testDirectionEngine();
+    testHysteresis();
+    testKeyMap();
+    testBrandMatcher();
+    testLatencyHistogram();
+    testSpscQueue();
+    testSeqLock();
+
+    if (g_failures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}